@@ -10,112 +10,538 @@
 #include "tlm.h"
 #include "tlm_utils/simple_target_socket.h"
 #include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/rotating_file_sink.h"
+#include "models/memories/loaders/image_loader.hpp"
 
 
 using namespace std;
 using namespace sc_dt;
 
 /**
- * N25QX defines a simplified model of a quad-spi (N25Q).
- * Out of the standard commands available, only READ_QUAD is
- * currently implemented
+ * N25QX defines a simplified model of a quad-spi (N25Q) in extended SPI mode:
+ * the command is always sent on DQ0, address and data use 1, 2 or 4 lines
+ * depending on the command.
+ *
+ * The content is a byte array of `size` bytes (a power of two, 16 MiB for
+ * an N25Q128), erased to 0xFF. Parts larger than 16 MiB are addressed either
+ * with the 4-byte commands or after ENTER 4-BYTE ADDRESS MODE.
+ * Program, erase and the other state changing commands are executed when
+ * cs_n is deasserted, and take no time (the status register never reports
+ * busy). Fast reads wait `dummy_cycles - 1` clocks after the address; the
+ * first data bits are driven on the following clock.
+ *
+ * `socket` serves memory-mapped (execute in place) reads of the same array:
+ * addresses are byte offsets in the flash, writes are refused (the content
+ * only changes through program/erase) and DMI gives read-only access to the
+ * whole array. The annotated delay is the duration of the equivalent
+ * `xip_command` read on the pins at `xip_clock_period`.
+ *
+ * With a `backing_file` the array is a shared mapping of that file: nothing
+ * is copied at start up and programs/erases land in the file, so the flash
+ * content survives across runs.
 */
 template <int IF_WIDTH=4>
 SC_MODULE(N25QX) {
-    // N25Q-128M
     // Command table:
-    // RESET ENABLE 0x66
-    // RESET MEMORY 0x99
+    // READ 0x03 (0x13)              1-1-1, no dummy
+    // FAST READ 0x0B (0x0C)         1-1-1
+    // DUAL OUTPUT READ 0x3B (0x3C)  1-1-2
+    // DUAL I/O READ 0xBB (0xBC)     1-2-2
+    // QUAD OUTPUT READ 0x6B (0x6C)  1-1-4
+    // QUAD I/O READ 0xEB (0xEC)     1-4-4
+    // PAGE PROGRAM 0x02 (0x12)      1-1-1
+    // QUAD INPUT PROGRAM 0x32 (0x34) 1-1-4
+    // SUBSECTOR ERASE 0x20 (0x21)   4 KiB
+    // SECTOR ERASE 0xD8 (0xDC)      64 KiB
+    // BULK ERASE 0xC7 / 0x60
+    // WRITE ENABLE 0x06, WRITE DISABLE 0x04
+    // READ STATUS 0x05, WRITE STATUS 0x01
+    // READ FLAG STATUS 0x70, CLEAR FLAG STATUS 0x50
     // READ ID 0x9E 0x9F
-    // READ 0x3
-    // FAST READ 0xB
+    // ENTER / EXIT 4-BYTE ADDRESS MODE 0xB7 / 0xE9
+    // RESET ENABLE 0x66, RESET MEMORY 0x99
+    // (codes in parentheses always take a 4-byte address)
     sc_in<sc_bv<1>>  cs_n;
     sc_inout<sc_bv<IF_WIDTH>> dq;
     sc_in<bool> clk;
+    tlm_utils::simple_target_socket_optional<N25QX> socket;
 
     const uint8_t CMD_QUAD_READ = 0xeb;
 
+    static const uint32_t PAGE_SIZE = 256;
+    static const uint32_t SUBSECTOR_SIZE = 4 * 1024;
+    static const uint32_t SECTOR_SIZE = 64 * 1024;
+
+    // Status register bits
+    static const uint8_t STATUS_WEL = 0x02;
+    // Flag status register bits
+    static const uint8_t FLAG_READY = 0x80;
+    static const uint8_t FLAG_ADDR4 = 0x01;
+
     enum class PHASE_T {IDLE_PHASE,
                         CMD_PHASE,
-                        QUAD_READ_ADDR_PHASE,
-                        QUAD_READ_DUMMY_PHASE,
-                        QUAD_READ_RESP_PHASE
+                        ADDR_PHASE,
+                        DUMMY_PHASE,
+                        DATA_OUT_PHASE,
+                        DATA_IN_PHASE,
+                        DONE_PHASE
                        };
     PHASE_T phase = PHASE_T::IDLE_PHASE;
 
+    // Source of the bytes shifted out in DATA_OUT_PHASE
+    enum class OUTPUT_T {MEMORY, STATUS, FLAG_STATUS, ID};
+
     uint8_t cmd;
-    uint32_t cnt ;
-    uint32_t addr;
+    uint32_t cnt;
+    uint64_t addr;
+    // Address of the byte being shifted out
+    uint64_t out_addr {0};
 
-    std::map<uint32_t, uint8_t> conf_memory;
+    // Flash contents
+    uint8_t* memory {nullptr};
+    uint64_t size;
 
     uint32_t dummy_cycles = 0;
 
+    // XIP timing through `socket`: SC_ZERO_TIME makes the reads untimed
+    sc_time xip_clock_period {SC_ZERO_TIME};
+    uint8_t xip_command {0xEB};
+    // Continuous read mode: the command phase is skipped
+    bool xip_continuous {false};
+
+    uint8_t status {0};
+    uint8_t flag_status {FLAG_READY};
+    bool four_byte {false};
+    bool reset_enabled {false};
+
     sc_bv<IF_WIDTH> spi_io_out;
 
-    uint32_t idx = 0;
+    uint64_t idx = 0;
     uint8_t word = 0;
 
+    // Decoded command
+    unsigned int addr_clocks {0};
+    unsigned int addr_width {1};
+    unsigned int data_width {1};
+    unsigned int dummy_left {0};
+    OUTPUT_T output {OUTPUT_T::MEMORY};
+    bool command_complete {false};
+
+    // Bits of the byte being shifted in or out
+    uint8_t shift {0};
+    unsigned int shift_bits {0};
+    bool driving {false};
+    std::vector<uint8_t> data_in;
+
+    uint64_t wrap(uint64_t address) const {
+        return address & (size - 1);
+    }
+
+    // Dummy clocks between the address and the data of the fast reads
+    unsigned int fast_read_dummy() const {
+        return dummy_cycles ? dummy_cycles - 1 : 0;
+    }
+
+    // Commands that always take a 4-byte address
+    static bool four_byte_command(uint8_t command) {
+        switch (command) {
+        case 0x13: case 0x0C: case 0x3C: case 0xBC: case 0x6C: case 0xEC:
+        case 0x12: case 0x34: case 0x21: case 0xDC:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * Line widths and dummy clocks of the read commands; false for the
+     * other commands
+     */
+    bool read_format(uint8_t command, unsigned int& a_width, unsigned int& d_width,
+                     unsigned int& dummy) const {
+        a_width = 1;
+        d_width = 1;
+        dummy = fast_read_dummy();
+        switch (command) {
+        case 0x03: case 0x13:
+            dummy = 0;
+            return true;
+        case 0x0B: case 0x0C:
+            return true;
+        case 0x3B: case 0x3C:
+            d_width = 2;
+            return true;
+        case 0xBB: case 0xBC:
+            a_width = d_width = 2;
+            return true;
+        case 0x6B: case 0x6C:
+            d_width = 4;
+            return true;
+        case 0xEB: case 0xEC:
+            a_width = d_width = 4;
+            return true;
+        default:
+            dummy = 0;
+            return false;
+        }
+    }
+
+    /**
+     * Decodes the command byte: sets the widths and lengths of the next phases
+     */
+    void start_command() {
+        bool addr4 = four_byte || four_byte_command(cmd);
+        output = OUTPUT_T::MEMORY;
+        data_in.clear();
+        phase = PHASE_T::ADDR_PHASE;
+        command_complete = false;
+        if (cmd != 0x99)
+            reset_enabled = false;
+        // The address, dummy and data phases of the reads come from read_format
+        if (!read_format(cmd, addr_width, data_width, dummy_left)) {
+            switch (cmd) {
+            case 0x02: case 0x12:
+                break;
+            case 0x32: case 0x34:
+                data_width = 4;
+                break;
+            case 0x20: case 0x21: case 0xD8: case 0xDC:
+                break;
+            case 0x05:
+                output = OUTPUT_T::STATUS;
+                phase = PHASE_T::DATA_OUT_PHASE;
+                break;
+            case 0x70:
+                output = OUTPUT_T::FLAG_STATUS;
+                phase = PHASE_T::DATA_OUT_PHASE;
+                break;
+            case 0x9E: case 0x9F:
+                output = OUTPUT_T::ID;
+                addr = 0;
+                phase = PHASE_T::DATA_OUT_PHASE;
+                break;
+            case 0x01:
+                phase = PHASE_T::DATA_IN_PHASE;
+                break;
+            case 0x06: case 0x04: case 0xB7: case 0xE9: case 0x50:
+            case 0x66: case 0x99: case 0xC7: case 0x60:
+                // Commands without address nor data
+                command_complete = true;
+                phase = PHASE_T::DONE_PHASE;
+                break;
+            default:
+                // Unknown commands are ignored until the device is deselected
+                command_complete = false;
+                phase = PHASE_T::DONE_PHASE;
+                break;
+            }
+        }
+        if (IF_WIDTH < 4 && (addr_width > IF_WIDTH || data_width > IF_WIDTH)) {
+            command_complete = false;
+            phase = PHASE_T::DONE_PHASE;
+        }
+        addr = (phase == PHASE_T::ADDR_PHASE) ? 0 : addr;
+        addr_clocks = (addr4 ? 32 : 24) / addr_width;
+        shift_bits = 0;
+        driving = false;
+        cnt = 0;
+    }
+
+    // Phase that follows the address
+    void end_of_address() {
+        switch (cmd) {
+        case 0x02: case 0x12: case 0x32: case 0x34:
+            phase = PHASE_T::DATA_IN_PHASE;
+            break;
+        case 0x20: case 0x21: case 0xD8: case 0xDC:
+            command_complete = true;
+            phase = PHASE_T::DONE_PHASE;
+            break;
+        default:
+            phase = dummy_left ? PHASE_T::DUMMY_PHASE : PHASE_T::DATA_OUT_PHASE;
+            break;
+        }
+    }
+
+    uint8_t next_output_byte() {
+        switch (output) {
+        case OUTPUT_T::STATUS:
+            return status;
+        case OUTPUT_T::FLAG_STATUS:
+            return flag_status | (four_byte ? FLAG_ADDR4 : 0);
+        case OUTPUT_T::ID: {
+            // Micron, 3V, capacity, then the extended bytes
+            unsigned int bits = 0;
+            while ((uint64_t(1) << bits) < size)
+                bits++;
+            const uint8_t id[4] = {0x20, 0xBA, uint8_t(bits <= 25 ? bits : 0x20 + (bits - 26)), 0x10};
+            return addr < 4 ? id[addr++] : 0;
+        }
+        default:
+            return memory[wrap(addr)];
+        }
+    }
+
+    // Value of the dq lines for `bits` (data_width wide); single-line data uses DQ1
+    sc_bv<IF_WIDTH> to_lines(uint8_t bits) {
+        if (data_width == 1 && IF_WIDTH > 1)
+            return sc_bv<IF_WIDTH>(bits << 1);
+        return sc_bv<IF_WIDTH>(bits);
+    }
+
+    uint8_t sample(unsigned int width) {
+        return dq.read().to_uint() & ((1 << width) - 1);
+    }
+
     void flash_handler() {
+        if (cs_n.read() == 1) {
+            return;
+        }
         if (clk) {
             switch(phase) {
             case PHASE_T::IDLE_PHASE:
-                if (cs_n.read() == 0) {
-                    cnt = 1;
-                    phase = PHASE_T::CMD_PHASE;
-                    cmd = dq.read().get_bit(0);
-                }
+                cnt = 1;
+                phase = PHASE_T::CMD_PHASE;
+                cmd = dq.read().get_bit(0);
                 break;
             case PHASE_T::CMD_PHASE:
-                if (cnt++ < 8) {
-                    cmd = (uint8_t) (dq.read().get_bit(0)) | (cmd << 1);
-                } else {
-                    if (cmd == CMD_QUAD_READ) {
-                        phase = PHASE_T::QUAD_READ_ADDR_PHASE;
-                        cnt = 1;
-                        addr = dq.read().to_uint();
-                    }
-                }
+                cmd = (uint8_t) (dq.read().get_bit(0)) | (cmd << 1);
+                if (++cnt == 8)
+                    start_command();
                 break;
-            case PHASE_T::QUAD_READ_ADDR_PHASE:
-                if (cnt++ < (24/ IF_WIDTH )) {
-                    addr = (addr << IF_WIDTH) | dq.read().to_uint();
-                } else {
-                    cnt = 2;
-                    dq.write(0);
-                    phase = PHASE_T::QUAD_READ_DUMMY_PHASE;
+            case PHASE_T::ADDR_PHASE:
+                addr = (addr << addr_width) | sample(addr_width);
+                if (++cnt == addr_clocks) {
+                    cnt = 0;
+                    end_of_address();
                 }
                 break;
-            case PHASE_T::QUAD_READ_DUMMY_PHASE:
+            case PHASE_T::DUMMY_PHASE:
                 dq.write(0);
-                if (++cnt >= dummy_cycles) {
-                    phase = PHASE_T::QUAD_READ_RESP_PHASE;
+                if (++cnt >= dummy_left) {
+                    phase = PHASE_T::DATA_OUT_PHASE;
                     cnt = 0;
-                    idx = 0;
-                    word = 0;
                 }
                 break;
-            case PHASE_T::QUAD_READ_RESP_PHASE:
-                if (cs_n.read()==0) {
-                    // Our address is half-byte aligned
-                    idx = (addr*2)+cnt;
-                    word = conf_memory[idx];
-                    cnt++;
-                    dq.write(word);
-                } else {
-                    phase = PHASE_T::IDLE_PHASE;
+            case PHASE_T::DATA_OUT_PHASE:
+                if (shift_bits == 0) {
+                    out_addr = addr;
+                    shift = next_output_byte();
+                    shift_bits = 8;
+                    if (output == OUTPUT_T::MEMORY)
+                        addr = wrap(addr + 1);
                 }
+                shift_bits -= data_width;
+                word = (shift >> shift_bits) & ((1 << data_width) - 1);
+                // Index of the bit group in the memory, as seen on the bus
+                idx = out_addr * (8 / data_width) + (8 - shift_bits) / data_width - 1;
+                driving = true;
+                dq.write(to_lines(word));
+                break;
+            case PHASE_T::DATA_IN_PHASE:
+                shift = (shift << data_width) | sample(data_width);
+                shift_bits += data_width;
+                if (shift_bits == 8) {
+                    data_in.push_back(shift);
+                    shift_bits = 0;
+                    command_complete = true;
+                }
+                break;
+            case PHASE_T::DONE_PHASE:
                 break;
             }
         } else {
-            if (phase == PHASE_T::QUAD_READ_RESP_PHASE) {
+            if (phase == PHASE_T::DATA_OUT_PHASE && driving && output == OUTPUT_T::MEMORY) {
                 spdlog::get("N25QX_logger")->info("{},0x{:x},{}, 0x{:x}",
-                                                  sc_time_stamp().to_string(), addr+(cnt/2), idx, word);
-                dq.write(word);
+                                                  sc_time_stamp().to_string(), out_addr, idx, word);
+                dq.write(to_lines(word));
+            }
+        }
+    }
+
+    /**
+     * Executes the state changing commands when the device is deselected
+     */
+    void deselect_handler() {
+        if (cs_n.read() != 1)
+            return;
+        if (phase != PHASE_T::IDLE_PHASE && command_complete)
+            execute();
+        phase = PHASE_T::IDLE_PHASE;
+        command_complete = false;
+    }
+
+    void execute() {
+        bool wel = status & STATUS_WEL;
+        switch (cmd) {
+        case 0x06:
+            status |= STATUS_WEL;
+            return;
+        case 0x04:
+            status &= ~STATUS_WEL;
+            return;
+        case 0xB7:
+            four_byte = true;
+            return;
+        case 0xE9:
+            four_byte = false;
+            return;
+        case 0x50:
+            flag_status = FLAG_READY;
+            return;
+        case 0x66:
+            reset_enabled = true;
+            return;
+        case 0x99:
+            if (reset_enabled) {
+                status = 0;
+                flag_status = FLAG_READY;
+                four_byte = false;
             }
+            reset_enabled = false;
+            return;
+        default:
+            break;
         }
+        if (!wel) {
+            spdlog::get("N25QX_logger")->info("{},CMD 0x{:x} ignored: write not enabled",
+                                              sc_time_stamp().to_string(), cmd);
+            return;
+        }
+        switch (cmd) {
+        case 0x01:
+            // WIP and WEL are read-only
+            status = (status & 0x03) | (data_in[0] & 0xFC);
+            break;
+        case 0x02: case 0x12: case 0x32: case 0x34:
+            program(addr, data_in);
+            break;
+        case 0x20: case 0x21:
+            erase(addr & ~uint64_t(SUBSECTOR_SIZE - 1), SUBSECTOR_SIZE);
+            break;
+        case 0xD8: case 0xDC:
+            erase(addr & ~uint64_t(SECTOR_SIZE - 1), SECTOR_SIZE);
+            break;
+        case 0xC7: case 0x60:
+            erase(0, size);
+            break;
+        default:
+            break;
+        }
+        status &= ~STATUS_WEL;
+    }
+
+    /**
+     * Programs `data` from `address`, wrapping inside the page; programming
+     * can only clear bits. Only the last PAGE_SIZE bytes sent are kept.
+     */
+    void program(uint64_t address, const std::vector<uint8_t>& data) {
+        address = wrap(address);
+        uint64_t page = address & ~uint64_t(PAGE_SIZE - 1);
+        size_t first = data.size() > PAGE_SIZE ? data.size() - PAGE_SIZE : 0;
+        uint64_t offset = (address + first) & (PAGE_SIZE - 1);
+        for (size_t i = first; i < data.size(); i++) {
+            memory[page + offset] &= data[i];
+            offset = (offset + 1) & (PAGE_SIZE - 1);
+        }
+        spdlog::get("N25QX_logger")->info("{},PROGRAM,0x{:x},{}",
+                                          sc_time_stamp().to_string(), address, data.size() - first);
+    }
+
+    void erase(uint64_t address, uint64_t len) {
+        address = wrap(address);
+        memset(memory + address, 0xFF, std::min(len, size - address));
+        spdlog::get("N25QX_logger")->info("{},ERASE,0x{:x},{}",
+                                          sc_time_stamp().to_string(), address, len);
+    }
+
+    /**
+     * Clocks taken by a `len` bytes `xip_command` read on the pins
+     */
+    uint64_t xip_clocks(unsigned int len) const {
+        unsigned int a_width, d_width, dummy;
+        read_format(xip_command, a_width, d_width, dummy);
+        bool addr4 = four_byte || four_byte_command(xip_command) || size > (uint64_t(1) << 24);
+        return (xip_continuous ? 0 : 8) + (addr4 ? 32 : 24) / a_width + dummy
+               + (uint64_t(len) * 8 + d_width - 1) / d_width;
+    }
+
+    void b_transport(tlm::tlm_generic_payload& trans, sc_time& delay) {
+        tlm::tlm_command cmd = trans.get_command();
+        sc_dt::uint64    addr = trans.get_address();
+        unsigned char*   ptr = trans.get_data_ptr();
+        unsigned int     len = trans.get_data_length();
+        unsigned char*   byt = trans.get_byte_enable_ptr();
+        unsigned int     wid = trans.get_streaming_width();
+
+        if (cmd == tlm::TLM_WRITE_COMMAND) {
+            trans.set_response_status( tlm::TLM_COMMAND_ERROR_RESPONSE );
+            return;
+        }
+        if (wid == 0) {
+            trans.set_response_status( tlm::TLM_BURST_ERROR_RESPONSE );
+            return;
+        }
+        if (wid > len)
+            wid = len;
+        if (addr >= size || wid > size - addr) {
+            trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
+            return;
+        }
+        if (cmd == tlm::TLM_READ_COMMAND) {
+            unsigned int byt_len = trans.get_byte_enable_length();
+            if (byt && byt_len == 0)
+                byt_len = len;
+            for (unsigned int done = 0; done < len; done += wid) {
+                unsigned int chunk = std::min(wid, len - done);
+                if (!byt) {
+                    memcpy(ptr + done, memory + addr, chunk);
+                    continue;
+                }
+                for (unsigned int i = 0; i < chunk; i++) {
+                    if (byt[(done + i) % byt_len])
+                        ptr[done + i] = memory[addr + i];
+                }
+            }
+        }
+        delay += xip_clock_period * double(xip_clocks(len));
+        trans.set_dmi_allowed(true);
+        trans.set_response_status( tlm::TLM_OK_RESPONSE );
+    }
+
+    // The array is contiguous: DMI covers the whole flash, read-only
+    bool get_direct_mem_ptr(tlm::tlm_generic_payload& trans, tlm::tlm_dmi& dmi_data) {
+        if (trans.get_address() >= size || trans.get_command() == tlm::TLM_WRITE_COMMAND)
+            return false;
+        dmi_data.allow_read();
+        dmi_data.set_dmi_ptr(memory);
+        dmi_data.set_start_address(0);
+        dmi_data.set_end_address(size - 1);
+        // Latency of a word fetch
+        dmi_data.set_read_latency(xip_clock_period * double(xip_clocks(4)));
+        return true;
+    }
+
+    // Debug accesses can also write, e.g. to patch the image
+    unsigned int transport_dbg(tlm::tlm_generic_payload& trans) {
+        tlm::tlm_command cmd = trans.get_command();
+        sc_dt::uint64    addr = trans.get_address();
+        unsigned int     len = trans.get_data_length();
+
+        if (addr >= size || cmd == tlm::TLM_IGNORE_COMMAND)
+            return 0;
+        unsigned int num_bytes = std::min<sc_dt::uint64>(len, size - addr);
+        if (cmd == tlm::TLM_WRITE_COMMAND)
+            memcpy(memory + addr, trans.get_data_ptr(), num_bytes);
+        else
+            memcpy(trans.get_data_ptr(), memory + addr, num_bytes);
+        return num_bytes;
     }
 
     void setup_logger(const char* filename) {
@@ -129,38 +555,98 @@ SC_MODULE(N25QX) {
     }
 
 
+    /**
+     * Preloads an image (raw binary, ELF, Intel HEX or SREC, see load_image).
+     * A raw binary is stored from byte `conf_addr`; the other formats are
+     * stored at the addresses they contain.
+     */
     void configure_region(std::string conf_file, uint32_t conf_addr) {
-        // Conf Memory
-        // Our memory is internally organized in blocks of half-words and we address it
-        // via a half-word address.
-        uint32_t address = conf_addr << 1;
-        std::ifstream is (conf_file, std::ifstream::binary);
-        if (is) {
-            // get length of file:
-            is.seekg (0, is.end);
-            int length = is.tellg();
-            is.seekg (0, is.beg);
-            char * buffer = new char [length];
-            // read data as a block:
-            is.read (buffer,length);
-            for (int i = 0; i<length; i++)
-            {
-                // Splitting in two half-words
-                conf_memory[address++] = (((uint8_t)buffer[i])>>4) & 0xF;
-                conf_memory[address++] = ((uint8_t)buffer[i]) & 0xF;
+        std::string error;
+        bool ok = load_image(conf_file, conf_addr,
+        [&](uint64_t address, const uint8_t* data, uint64_t len) {
+            if (address > size || len > size - address) {
+                error = "image does not fit in the memory";
+                return;
+            }
+            memcpy(memory + address, data, len);
+        }, error);
+        if (!ok || !error.empty()) {
+            std::string err = "Cannot load " + conf_file + ": " + error;
+            SC_REPORT_ERROR("N25QX", err.c_str());
+        }
+    }
+
+    /**
+     * Maps the flash contents: an anonymous erased array or, with a
+     * `backing_file`, a shared mapping of the file. A missing or shorter
+     * file is extended with erased bytes.
+     */
+    void map_memory(const char* backing_file) {
+        if (!backing_file) {
+            void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (ptr == MAP_FAILED) {
+                SC_REPORT_ERROR("N25QX", "Cannot allocate the flash contents");
+                return;
             }
-            is.close();
-            delete [] buffer;
+            memory = static_cast<uint8_t*>(ptr);
+            memset(memory, 0xFF, size);
+            return;
+        }
+        std::string err = std::string("Cannot map the flash backing file ") + backing_file;
+        int fd = ::open(backing_file, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            SC_REPORT_ERROR("N25QX", err.c_str());
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || uint64_t(st.st_size) > size) {
+            ::close(fd);
+            err += ": larger than the flash";
+            SC_REPORT_ERROR("N25QX", err.c_str());
+            return;
+        }
+        uint64_t file_size = st.st_size;
+        if (file_size < size && ftruncate(fd, size) != 0) {
+            ::close(fd);
+            SC_REPORT_ERROR("N25QX", err.c_str());
+            return;
         }
+        void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED) {
+            SC_REPORT_ERROR("N25QX", err.c_str());
+            return;
+        }
+        memory = static_cast<uint8_t*>(ptr);
+        if (file_size < size)
+            memset(memory + file_size, 0xFF, size - file_size);
     }
 
-    N25QX(sc_module_name name, uint32_t dummy_cycles=11, const char* filename="/workdir/build/N25QX.csv")
-        : sc_module(name),  dummy_cycles(dummy_cycles)
+    N25QX(sc_module_name name, uint32_t dummy_cycles=11, const char* filename="/workdir/build/N25QX.csv",
+          uint64_t size=16*1024*1024, const char* backing_file=nullptr)
+        : sc_module(name), socket("socket"), size(size), dummy_cycles(dummy_cycles)
     {
+        if (size == 0 || (size & (size - 1)) != 0) {
+            SC_REPORT_ERROR("N25QX", "The flash size must be a power of two");
+            return;
+        }
+        map_memory(backing_file);
         setup_logger(filename);
         SC_METHOD(flash_handler);
         sensitive << clk;
         dont_initialize();
+        SC_METHOD(deselect_handler);
+        sensitive << cs_n;
+        dont_initialize();
+        socket.register_b_transport(this, &N25QX::b_transport);
+        socket.register_get_direct_mem_ptr(this, &N25QX::get_direct_mem_ptr);
+        socket.register_transport_dbg(this, &N25QX::transport_dbg);
+    }
+
+    ~N25QX() {
+        if (memory)
+            munmap(memory, size);
     }
 
     SC_HAS_PROCESS(N25QX);
@@ -0,0 +1,362 @@
+/**
+ * @file image_loader.hpp
+ * @author Riverlane, 2020
+ *
+ */
+
+#ifndef __IMAGE_LOADER_H__
+#define __IMAGE_LOADER_H__
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Image formats understood by load_image. AUTO picks ELF from the magic
+ * number, Intel HEX (.hex, .ihex, .ihx) and SREC (.srec, .s19, .s28, .s37,
+ * .mot) from the file extension, and falls back to RAW: a raw binary is
+ * never taken for a text format because of its first bytes.
+ */
+enum class ImageFormat {AUTO, RAW, ELF, IHEX, SREC};
+
+/**
+ * Read-only memory mapping of a whole file
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            opened = true;
+            if (st.st_size > 0) {
+                void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (ptr != MAP_FAILED) {
+                    bytes = static_cast<const uint8_t*>(ptr);
+                    length = st.st_size;
+                    madvise(ptr, length, MADV_SEQUENTIAL);
+                } else {
+                    opened = false;
+                }
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (bytes)
+            munmap(const_cast<uint8_t*>(bytes), length);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool is_open() const {
+        return opened;
+    }
+
+    const uint8_t* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    const uint8_t* bytes {nullptr};
+    size_t length {0};
+    bool opened {false};
+};
+
+/**
+ * Stores `words` big-endian 32-bit words read from `src` into `dst` as host
+ * integers (the byte order the SDRAM model expects). `src` need not be aligned.
+ */
+inline void bswap32_copy(uint32_t* dst, const uint8_t* src, size_t words) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 4 <= words; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        // Swap the bytes of each 16-bit lane, then the two lanes of each word
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+#endif
+    for (; i < words; i++) {
+        uint32_t w;
+        memcpy(&w, src + i * 4, 4);
+        dst[i] = __builtin_bswap32(w);
+    }
+}
+
+namespace image_loader_detail {
+
+inline int hex_digit(uint8_t c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Decodes `count` hex byte pairs starting at p; false if p runs past end
+inline bool hex_bytes(const uint8_t* p, const uint8_t* end, size_t count, uint8_t* out) {
+    if (size_t(end - p) < count * 2)
+        return false;
+    for (size_t i = 0; i < count; i++) {
+        int hi = hex_digit(p[2 * i]);
+        int lo = hex_digit(p[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        out[i] = uint8_t((hi << 4) | lo);
+    }
+    return true;
+}
+
+/**
+ * Merges contiguous data records into one sink call (HEX and SREC records
+ * hold at most 255 bytes each).
+ */
+template<class SINK>
+class Coalescer {
+public:
+    explicit Coalescer(SINK& sink) : sink(sink) {
+        buffer.reserve(CHUNK);
+    }
+
+    void add(uint64_t address, const uint8_t* data, size_t len) {
+        if (!buffer.empty() && (address != start + buffer.size() || buffer.size() + len > CHUNK))
+            flush();
+        if (buffer.empty())
+            start = address;
+        buffer.insert(buffer.end(), data, data + len);
+    }
+
+    void flush() {
+        if (!buffer.empty())
+            sink(start, buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+private:
+    static constexpr size_t CHUNK = 1 << 16;
+    SINK& sink;
+    std::vector<uint8_t> buffer;
+    uint64_t start {0};
+};
+
+inline uint64_t read_uint(const uint8_t* p, int size, bool big_endian) {
+    uint64_t v = 0;
+    for (int i = 0; i < size; i++)
+        v |= uint64_t(p[big_endian ? size - 1 - i : i]) << (8 * i);
+    return v;
+}
+
+template<class SINK>
+bool load_elf(const uint8_t* file, size_t size, SINK& sink, std::string& error) {
+    if (size < 52 || (file[4] != 1 && file[4] != 2) || (file[5] != 1 && file[5] != 2)) {
+        error = "unsupported ELF header";
+        return false;
+    }
+    bool is64 = file[4] == 2;
+    bool be = file[5] == 2;
+    if (is64 && size < 64) {
+        error = "truncated ELF header";
+        return false;
+    }
+    uint64_t phoff = is64 ? read_uint(file + 32, 8, be) : read_uint(file + 28, 4, be);
+    uint64_t phentsize = read_uint(file + (is64 ? 54 : 42), 2, be);
+    uint64_t phnum = read_uint(file + (is64 ? 56 : 44), 2, be);
+    if (phentsize < (is64 ? 56u : 32u) || phoff > size || phnum * phentsize > size - phoff) {
+        error = "bad ELF program headers";
+        return false;
+    }
+    static const uint8_t zeros[4096] = {0};
+    for (uint64_t i = 0; i < phnum; i++) {
+        const uint8_t* ph = file + phoff + i * phentsize;
+        const uint32_t PT_LOAD = 1;
+        if (read_uint(ph, 4, be) != PT_LOAD)
+            continue;
+        uint64_t offset = is64 ? read_uint(ph + 8, 8, be) : read_uint(ph + 4, 4, be);
+        uint64_t paddr = is64 ? read_uint(ph + 24, 8, be) : read_uint(ph + 12, 4, be);
+        uint64_t filesz = is64 ? read_uint(ph + 32, 8, be) : read_uint(ph + 16, 4, be);
+        uint64_t memsz = is64 ? read_uint(ph + 40, 8, be) : read_uint(ph + 20, 4, be);
+        if (offset > size || filesz > size - offset) {
+            error = "ELF segment outside of the file";
+            return false;
+        }
+        if (filesz)
+            sink(paddr, file + offset, filesz);
+        // .bss and friends
+        for (uint64_t done = filesz; done < memsz; done += sizeof(zeros))
+            sink(paddr + done, zeros, std::min<uint64_t>(sizeof(zeros), memsz - done));
+    }
+    return true;
+}
+
+template<class SINK>
+bool load_ihex(const uint8_t* p, const uint8_t* end, SINK& sink, std::string& error) {
+    Coalescer<SINK> out(sink);
+    uint64_t upper = 0;
+    uint8_t record[5 + 255];
+    while (p < end) {
+        if (*p == '\r' || *p == '\n' || *p == ' ' || *p == '\t') {
+            p++;
+            continue;
+        }
+        if (*p != ':' || !hex_bytes(p + 1, end, 1, record) ||
+                !hex_bytes(p + 1, end, 5 + record[0], record)) {
+            error = "malformed Intel HEX record";
+            return false;
+        }
+        size_t len = record[0];
+        uint8_t sum = 0;
+        for (size_t i = 0; i < 5 + len; i++)
+            sum += record[i];
+        if (sum != 0) {
+            error = "Intel HEX checksum mismatch";
+            return false;
+        }
+        uint64_t address = (record[1] << 8) | record[2];
+        switch (record[3]) {
+        case 0x00:
+            out.add(upper + address, record + 4, len);
+            break;
+        case 0x01:
+            out.flush();
+            return true;
+        case 0x02:
+        case 0x04:
+            if (len != 2) {
+                error = "malformed Intel HEX address record";
+                return false;
+            }
+            upper = uint64_t((record[4] << 8) | record[5]) << (record[3] == 0x02 ? 4 : 16);
+            break;
+        default:
+            // Start address records do not carry data
+            break;
+        }
+        p += 1 + 2 * (5 + len);
+    }
+    out.flush();
+    return true;
+}
+
+template<class SINK>
+bool load_srec(const uint8_t* p, const uint8_t* end, SINK& sink, std::string& error) {
+    Coalescer<SINK> out(sink);
+    uint8_t record[1 + 255];
+    while (p < end) {
+        if (*p == '\r' || *p == '\n' || *p == ' ' || *p == '\t') {
+            p++;
+            continue;
+        }
+        if (*p != 'S' || end - p < 4 || hex_digit(p[1]) < 0 ||
+                !hex_bytes(p + 2, end, 1, record) || record[0] < 1 ||
+                !hex_bytes(p + 2, end, 1 + record[0], record)) {
+            error = "malformed SREC record";
+            return false;
+        }
+        int type = hex_digit(p[1]);
+        size_t count = record[0];
+        uint8_t sum = 0;
+        for (size_t i = 0; i < 1 + count; i++)
+            sum += record[i];
+        if (sum != 0xFF) {
+            error = "SREC checksum mismatch";
+            return false;
+        }
+        if (type >= 1 && type <= 3) {
+            size_t addr_len = type + 1;
+            if (count < addr_len + 1) {
+                error = "malformed SREC record";
+                return false;
+            }
+            uint64_t address = read_uint(record + 1, addr_len, true);
+            out.add(address, record + 1 + addr_len, count - addr_len - 1);
+        } else if (type >= 7 && type <= 9) {
+            out.flush();
+            return true;
+        }
+        p += 4 + 2 * count;
+    }
+    out.flush();
+    return true;
+}
+
+inline ImageFormat format_from_extension(const std::string& filename) {
+    size_t dot = filename.find_last_of("./");
+    if (dot == std::string::npos || filename[dot] != '.')
+        return ImageFormat::RAW;
+    std::string ext = filename.substr(dot + 1);
+    for (char& c : ext)
+        c = std::tolower(static_cast<unsigned char>(c));
+    if (ext == "hex" || ext == "ihex" || ext == "ihx")
+        return ImageFormat::IHEX;
+    if (ext == "srec" || ext == "s19" || ext == "s28" || ext == "s37" || ext == "mot")
+        return ImageFormat::SREC;
+    return ImageFormat::RAW;
+}
+
+} // namespace image_loader_detail
+
+/**
+ * Loads an image file and hands its content to `sink(address, data, len)`,
+ * which may be called several times. RAW files are delivered at
+ * `raw_address`, skipping their first `raw_skip` bytes; ELF (PT_LOAD
+ * segments, at their physical address, with zeros up to p_memsz), Intel HEX
+ * and SREC deliver the addresses they contain. The file is memory-mapped and
+ * `data` points into the mapping (or into a small staging buffer), so it is
+ * only valid during the call.
+ * Returns false and sets `error` when the file cannot be read or parsed.
+ */
+template<class SINK>
+bool load_image(const std::string& filename, uint64_t raw_address, SINK sink,
+                std::string& error, ImageFormat format = ImageFormat::AUTO,
+                uint64_t raw_skip = 0) {
+    using namespace image_loader_detail;
+    MappedFile file(filename);
+    if (!file.is_open()) {
+        error = "cannot open " + filename;
+        return false;
+    }
+    const uint8_t* data = file.data();
+    size_t size = file.size();
+    if (format == ImageFormat::AUTO) {
+        if (size >= 4 && memcmp(data, "\x7f" "ELF", 4) == 0)
+            format = ImageFormat::ELF;
+        else
+            format = format_from_extension(filename);
+    }
+    switch (format) {
+    case ImageFormat::ELF:
+        return load_elf(data, size, sink, error);
+    case ImageFormat::IHEX:
+        return load_ihex(data, data + size, sink, error);
+    case ImageFormat::SREC:
+        return load_srec(data, data + size, sink, error);
+    default:
+        if (raw_skip < size)
+            sink(raw_address, data + raw_skip, size - raw_skip);
+        return true;
+    }
+}
+
+#endif //__IMAGE_LOADER_H__
@@ -10,11 +10,20 @@
 #include "systemc.h"
 #include "tlm.h"
 #include "tlm_utils/simple_target_socket.h"
+#include "tlms/commons/byte_enable.hpp"
 #include <sstream>
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/rotating_file_sink.h"
-#include <map>
 #include <iomanip>
+#include <deque>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "models/memories/storage/sparse_storage.hpp"
+#include "models/memories/sdram/sdram_timing.hpp"
+#include "models/memories/loaders/image_loader.hpp"
 
 using namespace std;
 using namespace sc_dt;
@@ -25,10 +34,36 @@ struct SDRAM_GEOM {
     int col_bits = 0;
 };
 
+/**
+ * Header of a binary SDRAM checkpoint. It is followed by `ranges` records of
+ * {uint32_t first word, uint32_t word count, count words}, in host byte order.
+ */
+struct SDRAM_CHECKPOINT_HEADER {
+    char magic[8];
+    uint32_t version;
+    uint32_t row_bits;
+    uint32_t bank_bits;
+    uint32_t col_bits;
+    uint32_t offset;
+    uint32_t cas_latency;
+    uint32_t burst_length;
+    uint32_t flags;
+    uint64_t ranges;
+};
+
+static constexpr char SDRAM_CHECKPOINT_MAGIC[8] = {'S', 'D', 'R', 'A', 'M', 'C', 'K', 'P'};
+
 
 /**
  * A simplified SDRAM model with backdoors.
- * The backdoors are used to accelerate the movement and erasing of data
+ * The backdoors are used to accelerate the movement and erasing of data.
+ * Each copy/clear is done in bulk and logged once; when backdoor_word_time is
+ * set the data moves after words * backdoor_word_time, with backdoor_busy high
+ * meanwhile and backdoor_done notified at the end.
+ *
+ * `socket` gives untimed TLM access (b_transport, DMI, debug) to the same
+ * storage. Addresses are wishbone addresses: they are decoded with
+ * to_row_bank_column after removing OFFSET, so both views stay coherent.
 */
 template <int A_SIZE, int BA_SIZE>
 SC_MODULE(GENERIC_SDRAM) {
@@ -65,6 +100,9 @@ SC_MODULE(GENERIC_SDRAM) {
     sc_in<sc_bv<32>> backdoor_clear_to;
     sc_in<sc_bv<1>> backdoor_clear;
 
+    // Functional front door on the same storage; it may be left unbound.
+    tlm_utils::simple_target_socket_optional<GENERIC_SDRAM> socket;
+
     static constexpr uint8_t CS_H = 0x10;
     static constexpr uint8_t CS_L = 0x00;
     static constexpr uint8_t RAS_H = 0x08;
@@ -87,20 +125,70 @@ SC_MODULE(GENERIC_SDRAM) {
                                LOAD_MEM_REG = 0
                               };
 
-    std::map<uint32_t, uint32_t> mem;
-    std::vector<uint32_t> read_buf;
+    // Word-addressed; the init bitmap keeps hexdump limited to the words written
+    SparseStorage<uint32_t, 10, true> mem;
+
+    // Mode register: CAS latency and burst length, in clock cycles
+    unsigned int cas_latency {1};
+    unsigned int burst_length {1};
+    bool burst_interleaved {false};
+    bool single_write {false};
+
+    // Read data waiting to be driven on dq, in due order. A burst holds at
+    // most 8 beats and CL is at most 3, so the ring can never overflow.
+    struct ReadBeat {
+        uint64_t due;
+        uint32_t data;
+    };
+    static const unsigned int READ_PIPE_SIZE = 16;
+    ReadBeat read_pipe[READ_PIPE_SIZE];
+    unsigned int read_head {0};
+    unsigned int read_count {0};
+    uint64_t cycle {0};
+
+    // Write burst in progress
+    unsigned int write_beats_left {0};
+    unsigned int write_beat {0};
+    uint32_t write_row {0};
+    uint32_t write_bank {0};
+    uint32_t write_col {0};
 
     uint32_t bank_addr {0};
     uint32_t col_addr {0};
     static const int ROW_SIZE = 1<<BA_SIZE; 
     uint32_t row_addr [ROW_SIZE] = {0};
 
+    // Bank state machines, timing checks and row-buffer counters
+    SdramBankTracker<ROW_SIZE> bank_model;
+    // A10 of the current READ/WRITE (auto-precharge)
+    bool auto_precharge {false};
+
     bool verbose {false};
     bool extra_verbose {false};
 
     SDRAM_GEOM geometry;
     const uint32_t OFFSET;
 
+    // Time the backdoor takes to move or clear one word (zero: instantaneous)
+    sc_time backdoor_word_time {SC_ZERO_TIME};
+    // High while a backdoor operation is in progress
+    sc_signal<bool> backdoor_busy;
+    // Notified when the last queued backdoor operation completes
+    sc_event backdoor_done;
+
+    // Delay added to each access through `socket` (and reported for DMI)
+    sc_time tlm_latency {SC_ZERO_TIME};
+
+    struct BackdoorOp {
+        bool copy;
+        uint32_t from;
+        uint32_t to;
+        uint32_t words;
+    };
+    std::deque<BackdoorOp> backdoor_ops;
+    bool backdoor_running {false};
+    sc_event backdoor_step;
+
     uint32_t update_address() {
         // NOTE: the addressing mode is half-word
         return to_word_address(row_addr[bank_addr], bank_addr, col_addr);
@@ -124,68 +212,130 @@ SC_MODULE(GENERIC_SDRAM) {
         col = addr & ((1 << geometry.col_bits) - 1 );
     }
 
+    // Column of beat `i` of a burst starting at `col`, wrapping inside the burst
+    uint32_t burst_column(uint32_t col, unsigned int i) {
+        uint32_t mask = burst_length - 1;
+        uint32_t beat = burst_interleaved ? ((col ^ i) & mask) : ((col + i) & mask);
+        return (col & ~mask) | beat;
+    }
+
+    void write_word(uint32_t address) {
+        uint32_t data = dq.read().to_uint();
+        uint32_t byte_disable = dm.read().to_uint();
+        uint32_t prev_data = mem.read(address);
+        uint32_t mask = 0;
+        for (int i=0; i<4; i++) {
+            if ((byte_disable << (i)) & 0x1) {
+                mask = mask + (0xff << (i*8));
+            }
+        }
+        data = (data & (~mask)) | (prev_data & mask);
+        mem.write(address, data);
+        spdlog::get("SDRAM_logger")->info("{},WRITE,0x{:x},0x{:x}", sc_time_stamp().to_string(), toWishbone(address), data);
+    }
+
+    void schedule_read(uint64_t due, uint32_t data) {
+        read_pipe[(read_head + read_count) % READ_PIPE_SIZE] = {due, data};
+        read_count++;
+    }
+
+    // Drives dq with the beat due in this cycle, if any
+    void drive_read_data() {
+        if (read_count && read_pipe[read_head].due == cycle) {
+            uint32_t data = read_pipe[read_head].data;
+            spdlog::get("SDRAM_logger")->info("{},READ[RETURNED],-,0x{:x}", sc_time_stamp().to_string(), data);
+            dq.write(data);
+            read_head = (read_head + 1) % READ_PIPE_SIZE;
+            read_count--;
+        }
+    }
+
     void handle_cmd(CMD_T cmd) {
         uint32_t address;
-        uint32_t data, prev_data;
-        uint32_t byte_disable;
-        uint32_t mask;
+        uint32_t data;
+        uint32_t mode;
+        // Any command other than a NOP terminates a write burst
+        if (cmd != CMD_T::NOP_0 && cmd != CMD_T::NOP_1)
+            write_beats_left = 0;
         switch(cmd) {
         case CMD_T::NOP_0:
         case CMD_T::NOP_1:
-            if (!read_buf.empty()) {
-                spdlog::get("SDRAM_logger")->info("{},READ[RETURNED],-,0x{:x}", sc_time_stamp().to_string(), read_buf.back());
-                dq.write(read_buf.back());
-                read_buf.pop_back();
+            if (write_beats_left) {
+                uint32_t col = burst_column(write_col, ++write_beat);
+                write_word(to_word_address(write_row, write_bank, col));
+                write_beats_left--;
             }
             break;
         case CMD_T::ACTIVATE:
             bank_addr = ba.read().to_uint();
             row_addr[bank_addr] = a.read().to_uint();
+            bank_model.activate(bank_addr, row_addr[bank_addr]);
             spdlog::get("SDRAM_logger")->info("{},ACTIVATE,-,-", sc_time_stamp().to_string());
             break;
         case CMD_T::READ:
             bank_addr = ba.read().to_uint();
-            col_addr = a.read().to_uint();
+            col_addr = a.read().to_uint() & ((1 << geometry.col_bits) - 1);
             address = update_address();
-            if (mem.count(address) == 0) {
-                read_buf.push_back(0);
-            } else {
-                read_buf.push_back(mem[address]);
+            data = mem.read(address);
+            // A new READ truncates the burst still in flight
+            while (read_count && read_pipe[(read_head + read_count - 1) % READ_PIPE_SIZE].due >= cycle + cas_latency)
+                read_count--;
+            schedule_read(cycle + cas_latency, data);
+            for (unsigned int i = 1; i < burst_length; i++) {
+                uint32_t row = row_addr[bank_addr];
+                uint32_t col = burst_column(col_addr, i);
+                schedule_read(cycle + cas_latency + i, mem.read(to_word_address(row, bank_addr, col)));
             }
-            spdlog::get("SDRAM_logger")->info("{},READ[REQUESTED],0x{:x},[0x{:x}]", sc_time_stamp().to_string(), toWishbone(address), mem[address]);
+            bank_model.access(false, bank_addr, auto_precharge);
+            if (auto_precharge)
+                row_addr[bank_addr] = 0;
+            spdlog::get("SDRAM_logger")->info("{},READ[REQUESTED],0x{:x},[0x{:x}]", sc_time_stamp().to_string(), toWishbone(address), data);
             break;
         case CMD_T::WRITE:
             bank_addr = ba.read().to_uint();
-            col_addr = a.read().to_uint();
+            col_addr = a.read().to_uint() & ((1 << geometry.col_bits) - 1);
             address = update_address();
-            data = dq.read().to_uint();
-            byte_disable = dm.read().to_uint();
-            prev_data = mem[address];
-            mask = 0;
-            for (int i=0; i<4; i++) {
-                if ((byte_disable << (i)) & 0x1) {
-                    mask = mask + (0xff << (i*8));
-                }
+            write_word(address);
+            if (!single_write && burst_length > 1) {
+                write_beats_left = burst_length - 1;
+                write_beat = 0;
+                write_row = row_addr[bank_addr];
+                write_bank = bank_addr;
+                write_col = col_addr;
             }
-            mem[address] = (data & (~mask)) | (prev_data & mask);
-            spdlog::get("SDRAM_logger")->info("{},WRITE,0x{:x},0x{:x}", sc_time_stamp().to_string(), toWishbone(address), mem[address]);
+            bank_model.access(true, bank_addr, auto_precharge);
+            if (auto_precharge)
+                row_addr[bank_addr] = 0;
             break;
         case CMD_T::PRECHARGE:
             bank_addr = ba.read().to_uint();
             row_addr[bank_addr] = 0;
+            bank_model.precharge(bank_addr);
             spdlog::get("SDRAM_logger")->info("{},PRECHARGE,-,-", sc_time_stamp().to_string());
             break;
         case CMD_T::PRECHARGE_ALL:
             for (int i=0; i < ROW_SIZE; i++){
                 row_addr[i] = 0;
             }
+            bank_model.precharge_all();
             spdlog::get("SDRAM_logger")->info("{},PRECHARGE_ALL,-,-", sc_time_stamp().to_string());
             break;
         case CMD_T::REFRESH:
+            bank_model.refresh();
             spdlog::get("SDRAM_logger")->info("{},REFRESH,-,-", sc_time_stamp().to_string());
             break;
         case CMD_T::LOAD_MEM_REG:
-            spdlog::get("SDRAM_logger")->info("{},LOAD_MEM_REG,x,x", sc_time_stamp().to_string());
+            // A[2:0] burst length, A3 burst type, A[6:4] CAS latency, A9 single write.
+            // Reserved encodings leave the current setting unchanged.
+            mode = a.read().to_uint();
+            if ((mode & 0x7) <= 3)
+                burst_length = 1 << (mode & 0x7);
+            burst_interleaved = (mode >> 3) & 0x1;
+            if (((mode >> 4) & 0x7) >= 1 && ((mode >> 4) & 0x7) <= 3)
+                cas_latency = (mode >> 4) & 0x7;
+            single_write = (mode >> 9) & 0x1;
+            spdlog::get("SDRAM_logger")->info("{},LOAD_MEM_REG,CL={},BL={}", sc_time_stamp().to_string(),
+                                              cas_latency, burst_length);
             break;
         }
     }
@@ -198,9 +348,18 @@ SC_MODULE(GENERIC_SDRAM) {
                 agg = CS_H;
             } else {
                 agg = (ras_n.read().to_uint() << 3) + (cas_n.read().to_uint() << 2) + 
-                    (we_n.read().to_uint() << 1) + (add.get_bit(10));
+                    (we_n.read().to_uint() << 1);
+                // A10 selects PRECHARGE_ALL; on READ/WRITE it requests an
+                // auto-precharge and on ACTIVATE it is a row address bit.
+                if (agg == uint8_t(CMD_T::PRECHARGE))
+                    agg += add.get_bit(10);
+                auto_precharge = add.get_bit(10);
             }
-            handle_cmd(CMD_T{agg});
+            CMD_T cmd {agg};
+            cycle++;
+            bank_model.tick(cmd == CMD_T::NOP_0 || cmd == CMD_T::NOP_1);
+            drive_read_data();
+            handle_cmd(cmd);
         }
     }
 
@@ -213,30 +372,188 @@ SC_MODULE(GENERIC_SDRAM) {
     }
 
     void backdoor_handler() {
-        uint32_t start_add, end_add;
         if (backdoor_copy.read() == 1) {
-            start_add = fromWishbone(backdoor_copy_from.read().to_uint());
-            end_add = fromWishbone(backdoor_copy_to.read().to_uint());
-            uint32_t tsize = backdoor_copy_size.read().to_uint() >> 2;
-            for (uint32_t i=0; i<tsize; i++) {
-                spdlog::get("SDRAM_logger")->info("{},BACKDOOR_COPY,0x{:x}, 0x{:x}",
-                                                  sc_time_stamp().to_string(),
-                                                  toWishbone(end_add+i), mem[start_add+i]);
-                mem[end_add+i] = mem[start_add+i];
-            }
+            backdoor_ops.push_back({true,
+                                    fromWishbone(backdoor_copy_from.read().to_uint()),
+                                    fromWishbone(backdoor_copy_to.read().to_uint()),
+                                    backdoor_copy_size.read().to_uint() >> 2});
         }
         if (backdoor_clear.read() == 1) {
-            start_add = fromWishbone(backdoor_clear_from.read().to_uint());
-            end_add = fromWishbone(backdoor_clear_to.read().to_uint());
-            for (uint32_t i=start_add; i<end_add; i++) {
-                spdlog::get("SDRAM_logger")->info("{},BACKDOOR_CLEAR,0x{:x}, 0",
-                                                  sc_time_stamp().to_string(), toWishbone(i), 0);
-                mem[i] = 0;
+            uint32_t start_add = fromWishbone(backdoor_clear_from.read().to_uint());
+            uint32_t end_add = fromWishbone(backdoor_clear_to.read().to_uint());
+            backdoor_ops.push_back({false, 0, start_add, end_add > start_add ? end_add - start_add : 0});
+        }
+        if (backdoor_running)
+            return;
+        if (backdoor_word_time == SC_ZERO_TIME) {
+            while (!backdoor_ops.empty()) {
+                run_backdoor_op(backdoor_ops.front());
+                backdoor_ops.pop_front();
             }
+            backdoor_done.notify(SC_ZERO_TIME);
+        } else {
+            start_backdoor_op();
+        }
+    }
+
+    void start_backdoor_op() {
+        if (backdoor_ops.empty())
+            return;
+        backdoor_running = true;
+        backdoor_busy.write(true);
+        backdoor_step.notify(backdoor_word_time * backdoor_ops.front().words);
+    }
+
+    // The data is moved when the modelled duration has elapsed
+    void backdoor_complete() {
+        run_backdoor_op(backdoor_ops.front());
+        backdoor_ops.pop_front();
+        if (!backdoor_ops.empty()) {
+            start_backdoor_op();
+            return;
+        }
+        backdoor_running = false;
+        backdoor_busy.write(false);
+        backdoor_done.notify(SC_ZERO_TIME);
+    }
+
+    void run_backdoor_op(const BackdoorOp& op) {
+        if (op.copy) {
+            spdlog::get("SDRAM_logger")->info("{},BACKDOOR_COPY,0x{:x},0x{:x}[0x{:x}]",
+                                              sc_time_stamp().to_string(), toWishbone(op.to),
+                                              toWishbone(op.from), op.words << 2);
+            mem.copy(op.to, op.from, op.words);
+        } else {
+            spdlog::get("SDRAM_logger")->info("{},BACKDOOR_CLEAR,0x{:x},0[0x{:x}]",
+                                              sc_time_stamp().to_string(), toWishbone(op.to), op.words << 2);
+            mem.fill(op.to, op.words, 0);
         }
     }
 
 
+    uint64_t capacity_bytes() const {
+        return uint64_t(4) << (geometry.row_bits + geometry.bank_bits + geometry.col_bits);
+    }
+
+    uint32_t tlm_word_index(uint64_t offset) {
+        uint32_t row, bank, col;
+        to_row_bank_column(offset, row, bank, col);
+        return to_word_address(row, bank, col);
+    }
+
+    /**
+     * Copies `len` bytes between `data` and the storage starting at byte
+     * `offset` (relative to OFFSET). Byte enables follow the TLM rules.
+     */
+    void tlm_access(bool write, uint64_t offset, unsigned char* data, unsigned int len,
+                    const unsigned char* byt = nullptr, unsigned int byt_len = 0,
+                    unsigned int be_offset = 0) {
+        while (len) {
+            uint32_t index = tlm_word_index(offset);
+            unsigned int first = offset & 3;
+            uint64_t words;
+            unsigned int chunk;
+            if (write) {
+                unsigned char* cell = reinterpret_cast<unsigned char*>(mem.page_pointer(index, words)) + first;
+                chunk = std::min<uint64_t>(len, words * 4 - first);
+                if (byt)
+                    masked_copy(cell, data, chunk, byt, byt_len, be_offset);
+                else
+                    memcpy(cell, data, chunk);
+                mem.set_initialized(index, (first + chunk + 3) / 4);
+            } else {
+                const unsigned char* cell = reinterpret_cast<const unsigned char*>(mem.find_pointer(index, words));
+                chunk = std::min<uint64_t>(len, words * 4 - first);
+                for (unsigned int i = 0; i < chunk; i++) {
+                    if (!byt || byt[(be_offset + i) % byt_len])
+                        data[i] = cell ? cell[first + i] : 0;
+                }
+            }
+            offset += chunk;
+            data += chunk;
+            be_offset += chunk;
+            len -= chunk;
+        }
+    }
+
+    void b_transport(tlm::tlm_generic_payload& trans, sc_time& delay) {
+        tlm::tlm_command cmd = trans.get_command();
+        sc_dt::uint64    addr = trans.get_address();
+        unsigned char*   ptr = trans.get_data_ptr();
+        unsigned int     len = trans.get_data_length();
+        unsigned char*   byt = trans.get_byte_enable_ptr();
+        unsigned int     wid = trans.get_streaming_width();
+
+        if (wid == 0) {
+            trans.set_response_status( tlm::TLM_BURST_ERROR_RESPONSE );
+            return;
+        }
+        if (wid > len)
+            wid = len;
+        if (addr < OFFSET || addr - OFFSET >= capacity_bytes() || wid > capacity_bytes() - (addr - OFFSET)) {
+            trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
+            return;
+        }
+        if (cmd != tlm::TLM_IGNORE_COMMAND) {
+            unsigned int byt_len = trans.get_byte_enable_length();
+            if (byt && byt_len == 0)
+                byt_len = len;
+            for (unsigned int done = 0; done < len; done += wid)
+                tlm_access(cmd == tlm::TLM_WRITE_COMMAND, addr - OFFSET, ptr + done,
+                           std::min(wid, len - done), byt, byt_len, done);
+        }
+        delay += tlm_latency;
+        trans.set_dmi_allowed(true);
+        trans.set_response_status( tlm::TLM_OK_RESPONSE );
+    }
+
+    // DMI is granted one storage page at a time, as pages are not contiguous
+    bool get_direct_mem_ptr(tlm::tlm_generic_payload& trans, tlm::tlm_dmi& dmi_data) {
+        sc_dt::uint64 addr = trans.get_address();
+        if (addr < OFFSET || addr - OFFSET >= capacity_bytes())
+            return false;
+        uint64_t offset = (addr - OFFSET) & ~uint64_t(3);
+        uint32_t index = tlm_word_index(offset);
+        uint64_t words;
+        uint32_t* page = mem.page_pointer(index, words);
+        if (trans.is_write()) {
+            // Words written through the pointer are not tracked individually
+            mem.set_initialized(index, words);
+            dmi_data.allow_read_write();
+        } else {
+            // Read requests get read-only access: unwritten words stay out
+            // of hexdump and checkpoint
+            dmi_data.allow_read();
+        }
+        dmi_data.set_dmi_ptr(reinterpret_cast<unsigned char*>(page));
+        dmi_data.set_start_address(addr & ~sc_dt::uint64(3));
+        dmi_data.set_end_address((addr & ~sc_dt::uint64(3)) + words * 4 - 1);
+        dmi_data.set_read_latency(tlm_latency);
+        dmi_data.set_write_latency(tlm_latency);
+        return true;
+    }
+
+    unsigned int transport_dbg(tlm::tlm_generic_payload& trans) {
+        tlm::tlm_command cmd = trans.get_command();
+        sc_dt::uint64    addr = trans.get_address();
+        unsigned int     len = trans.get_data_length();
+
+        if (addr < OFFSET || addr - OFFSET >= capacity_bytes() || cmd == tlm::TLM_IGNORE_COMMAND)
+            return 0;
+        unsigned int num_bytes = std::min<sc_dt::uint64>(len, capacity_bytes() - (addr - OFFSET));
+        tlm_access(cmd == tlm::TLM_WRITE_COMMAND, addr - OFFSET, trans.get_data_ptr(), num_bytes);
+        return num_bytes;
+    }
+
+    /**
+     * Revokes the DMI pointers handed out through `socket`; needed after
+     * mem.clear() releases the pages.
+     */
+    void invalidate_dmi() {
+        if (socket.size())
+            socket->invalidate_direct_mem_ptr(0, ~sc_dt::uint64(0));
+    }
+
     void setup_logger(const char* filename) {
         // We setup n rotating logs to avoid consuming an excessive amount of memory
         auto max_size = 128*1024*1024;
@@ -249,70 +566,237 @@ SC_MODULE(GENERIC_SDRAM) {
     }
 
 
+    /**
+     * Preloads an image (raw binary, ELF, Intel HEX or SREC, see load_image).
+     * A raw binary is stored from byte `conf_addr` of the memory, skipping its
+     * first `first_byte` bytes; the other formats carry wishbone addresses,
+     * which are rebased by OFFSET. Words are big-endian in the image unless
+     * `msb` is set, in which case bytes are copied in host order.
+     */
     void configure_region(std::string conf_file, uint32_t conf_addr, uint32_t first_byte=0, bool msb=false) {
-        std::ifstream is (conf_file, std::ifstream::binary);
-        if (is) {
-            // get length of file:
-            is.seekg (first_byte, is.end);
-            int length = is.tellg();
-            is.seekg (first_byte, is.beg);
-            char * buffer = new char [length];
-            // read data as a block:
-            is.read ((char *) buffer, length);
-            is.close();
-            // Start saving it as a map
-            int rem = length % 4;
-            uint32_t val = 0;
-            // Address needs to be word aligned
-            conf_addr = conf_addr >> 2;
-            for (int i = 0; i<(length-rem); i=i+4)
-            {
-                memcpy(&val, &(buffer[i]), 4);
-                if (msb) {
-                    mem[conf_addr++] = val;
-                } else {
-                    mem[conf_addr++] = __bswap_32(val);
-                }
-            };
-            // Copy last bytes.
-            if (rem) {
-                memcpy(&val, &(buffer[length-rem]), rem);
-                mem[conf_addr] = val;
+        std::string error;
+        bool ok = load_image(conf_file, uint64_t(OFFSET) + conf_addr,
+        [&](uint64_t address, const uint8_t* data, uint64_t len) {
+            if (address < OFFSET || address - OFFSET > capacity_bytes() ||
+                    len > capacity_bytes() - (address - OFFSET)) {
+                error = "image does not fit in the memory";
+                return;
             }
+            store_image(address - OFFSET, data, len, msb);
+        }, error, ImageFormat::AUTO, first_byte);
+        if (!ok || !error.empty()) {
+            std::string err = "Cannot load " + conf_file + ": " + error;
+            SC_REPORT_ERROR("SDRAM", err.c_str());
+        }
+    }
+
+    void store_byte(uint64_t offset, uint8_t byte, bool msb) {
+        unsigned int shift = msb ? (offset & 3) * 8 : (3 - (offset & 3)) * 8;
+        uint32_t word = mem.read(offset >> 2);
+        word = (word & ~(0xFFu << shift)) | (uint32_t(byte) << shift);
+        mem.write(offset >> 2, word);
+    }
+
+    // Whole words are converted straight into the storage pages
+    void store_image(uint64_t offset, const uint8_t* data, uint64_t len, bool msb) {
+        for (; len && (offset & 3); len--)
+            store_byte(offset++, *data++, msb);
+        while (len >= 4) {
+            uint64_t words;
+            uint32_t* dst = mem.page_pointer(offset >> 2, words);
+            words = std::min<uint64_t>(words, len >> 2);
+            if (msb)
+                memcpy(dst, data, words * 4);
+            else
+                bswap32_copy(dst, data, words);
+            mem.set_initialized(offset >> 2, words);
+            offset += words * 4;
+            data += words * 4;
+            len -= words * 4;
         }
+        for (; len; len--)
+            store_byte(offset++, *data++, msb);
     }
 
     void hexdump(std::string filename) {
-        ofstream myfile (filename);
+        static const char digits[] = "0123456789abcdef";
+        std::ofstream myfile (filename, std::ofstream::binary);
+        std::vector<char> buffer;
+        buffer.reserve(1 << 20);
+        auto put_hex = [&](uint32_t value, int width) {
+            for (int i = width - 1; i >= 0; i--)
+                buffer.push_back(digits[(value >> (i * 4)) & 0xf]);
+        };
         int cnt = 0;
-        std::string line;
         uint32_t last_address = 0;
-        for( auto const& [key, val] : mem )
-        {
-            uint32_t address = key*4;
-            // There was a jump in the map
-            if (address > (last_address+4)){
-                myfile << std::endl;
-                cnt = 0;
+        mem.for_each_range([&](uint32_t first, const uint32_t* data, uint64_t count) {
+            for (uint64_t w = 0; w < count; w++) {
+                uint32_t address = (first + w) * 4;
+                uint32_t val = data[w];
+                // There was a jump in the written words
+                if (address > (last_address+4)){
+                    buffer.push_back('\n');
+                    cnt = 0;
+                }
+                if (cnt % 4 == 0)
+                    put_hex(address, 8);
+                for (int i=0; i<4; i++) {
+                    buffer.push_back(' ');
+                    put_hex((val >> ((3-i) * 8)) & 0xff, 2);
+                }
+                if (cnt % 4 == 3)
+                    buffer.push_back('\n');
+                cnt++;
+                // keeping track of the previous address.
+                last_address = address;
             }
-            if (cnt % 4 == 0)
-                myfile << std::setfill ('0') << std::setw(8) << std::hex << (unsigned int)(address);
-            for (int i=0; i<4; i++) {
-                myfile << " " << std::setfill ('0') << std::setw(2) <<
-                       std::hex << (unsigned int) ((val >>((3-i) * 8)) & 0xff) ;
+            if (buffer.size() > (1 << 20) - 4096) {
+                myfile.write(buffer.data(), buffer.size());
+                buffer.clear();
             }
-            if (cnt % 4 == 3)
-                myfile << std::endl;
-            cnt++;
-            // keeping track of the previous address.
-            last_address = address;
-        }
+        });
+        myfile.write(buffer.data(), buffer.size());
         myfile.close();
     }
 
+    /**
+     * Saves the written words, the geometry, OFFSET and the mode register
+     * into a binary checkpoint that `restore` can reload.
+     */
+    bool checkpoint(std::string filename) {
+        SDRAM_CHECKPOINT_HEADER header;
+        memcpy(header.magic, SDRAM_CHECKPOINT_MAGIC, sizeof(header.magic));
+        header.version = 1;
+        header.row_bits = geometry.row_bits;
+        header.bank_bits = geometry.bank_bits;
+        header.col_bits = geometry.col_bits;
+        header.offset = OFFSET;
+        header.cas_latency = cas_latency;
+        header.burst_length = burst_length;
+        header.flags = (burst_interleaved ? 1 : 0) | (single_write ? 2 : 0);
+        header.ranges = 0;
+        mem.for_each_range([&](uint32_t, const uint32_t*, uint64_t) {
+            header.ranges++;
+        });
+
+        std::FILE* file = std::fopen(filename.c_str(), "wb");
+        if (!file) {
+            std::string err = "Cannot create checkpoint " + filename;
+            SC_REPORT_ERROR("SDRAM", err.c_str());
+            return false;
+        }
+        std::vector<char> io_buffer(1 << 20);
+        setvbuf(file, io_buffer.data(), _IOFBF, io_buffer.size());
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        mem.for_each_range([&](uint32_t first, const uint32_t* data, uint64_t count) {
+            uint32_t range[2] = {first, uint32_t(count)};
+            ok = ok && std::fwrite(range, sizeof(range), 1, file) == 1;
+            ok = ok && std::fwrite(data, sizeof(uint32_t), count, file) == count;
+        });
+        ok = (std::fclose(file) == 0) && ok;
+        if (!ok) {
+            std::string err = "Cannot write checkpoint " + filename;
+            SC_REPORT_ERROR("SDRAM", err.c_str());
+        }
+        return ok;
+    }
+
+    /**
+     * Replaces the memory content with a checkpoint saved by `checkpoint`.
+     * The geometry and OFFSET must match the ones of this model. A file that
+     * is truncated, holds ranges outside of the memory or has an invalid CAS
+     * latency or burst length is rejected and the content is left untouched.
+     */
+    bool restore(std::string filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(SDRAM_CHECKPOINT_HEADER)) {
+            if (fd >= 0)
+                ::close(fd);
+            std::string err = "Cannot read checkpoint " + filename;
+            SC_REPORT_ERROR("SDRAM", err.c_str());
+            return false;
+        }
+        void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED) {
+            std::string err = "Cannot map checkpoint " + filename;
+            SC_REPORT_ERROR("SDRAM", err.c_str());
+            return false;
+        }
+        madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+        const uint8_t* base = static_cast<const uint8_t*>(ptr);
+        const uint8_t* end = base + st.st_size;
+        SDRAM_CHECKPOINT_HEADER header;
+        memcpy(&header, base, sizeof(header));
+        const char* error = nullptr;
+        if (memcmp(header.magic, SDRAM_CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 || header.version != 1)
+            error = "not an SDRAM checkpoint";
+        else if (header.row_bits != uint32_t(geometry.row_bits) || header.bank_bits != uint32_t(geometry.bank_bits) ||
+                 header.col_bits != uint32_t(geometry.col_bits) || header.offset != OFFSET)
+            error = "geometry or OFFSET does not match";
+        // Same limits as LOAD_MEM_REG
+        else if (header.cas_latency < 1 || header.cas_latency > 3 ||
+                 (header.burst_length != 1 && header.burst_length != 2 &&
+                  header.burst_length != 4 && header.burst_length != 8))
+            error = "invalid CAS latency or burst length";
+        // Every range is checked before the memory is touched: a bad file
+        // is rejected as a whole
+        const uint8_t* data = base + sizeof(header);
+        const uint8_t* cursor = data;
+        const uint64_t capacity_words = capacity_bytes() / 4;
+        for (uint64_t i = 0; i < header.ranges && !error; i++) {
+            uint32_t range[2];
+            if (size_t(end - cursor) < sizeof(range)) {
+                error = "truncated file";
+                break;
+            }
+            memcpy(range, cursor, sizeof(range));
+            cursor += sizeof(range);
+            if (uint64_t(range[0]) + range[1] > capacity_words)
+                error = "range outside of the memory";
+            else if (uint64_t(end - cursor) < uint64_t(range[1]) * 4)
+                error = "truncated file";
+            else
+                cursor += uint64_t(range[1]) * 4;
+        }
+        if (!error) {
+            invalidate_dmi();
+            mem.clear();
+            cursor = data;
+            for (uint64_t i = 0; i < header.ranges; i++) {
+                uint32_t range[2];
+                memcpy(range, cursor, sizeof(range));
+                cursor += sizeof(range);
+                // Records are 4-byte aligned in the (page aligned) mapping
+                mem.write(range[0], reinterpret_cast<const uint32_t*>(cursor), range[1]);
+                cursor += uint64_t(range[1]) * 4;
+            }
+            cas_latency = header.cas_latency;
+            burst_length = header.burst_length;
+            burst_interleaved = header.flags & 1;
+            single_write = header.flags & 2;
+        }
+        munmap(ptr, st.st_size);
+        if (error) {
+            std::string err = "Cannot restore checkpoint " + filename + ": " + error;
+            SC_REPORT_ERROR("SDRAM", err.c_str());
+            return false;
+        }
+        return true;
+    }
+
     GENERIC_SDRAM(sc_module_name name, SDRAM_GEOM geom, const char* filename="/workdir/build/sdram.csv", const uint32_t OFFSET=0x40000000)
-        : sc_module(name), geometry(geom), OFFSET(OFFSET)
+        : sc_module(name), socket("socket"),
+          bank_model([this](const std::string& msg) {
+              std::string err = std::string(this->name()) + ": " + msg;
+              SC_REPORT_WARNING("SDRAM", err.c_str());
+          }),
+          geometry(geom), OFFSET(OFFSET)
     {
+        socket.register_b_transport(this, &GENERIC_SDRAM::b_transport);
+        socket.register_get_direct_mem_ptr(this, &GENERIC_SDRAM::get_direct_mem_ptr);
+        socket.register_transport_dbg(this, &GENERIC_SDRAM::transport_dbg);
         setup_logger(filename);
         SC_METHOD(sdram_handler);
         sensitive << ck << cke;
@@ -320,6 +804,17 @@ SC_MODULE(GENERIC_SDRAM) {
         SC_METHOD(backdoor_handler);
         sensitive << backdoor_copy << backdoor_clear;
         dont_initialize();
+        SC_METHOD(backdoor_complete);
+        sensitive << backdoor_step;
+        dont_initialize();
+    }
+
+    void end_of_simulation() {
+        std::stringstream summary;
+        bank_model.stats.dump(summary);
+        std::string line;
+        while (std::getline(summary, line))
+            spdlog::get("SDRAM_logger")->info("{},STATS,{}", sc_time_stamp().to_string(), line);
     }
 
     SC_HAS_PROCESS(GENERIC_SDRAM);
@@ -0,0 +1,227 @@
+/**
+ * @file sdram_timing.hpp
+ * @author Riverlane, 2020
+ *
+ */
+
+#ifndef __SDRAM_TIMING_H__
+#define __SDRAM_TIMING_H__
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+/**
+ * SDRAM timing constraints, in clock cycles. A value of 0 disables the check.
+ */
+struct SDRAM_TIMING {
+    uint32_t tRCD = 0;   // ACTIVATE to READ/WRITE, same bank
+    uint32_t tRP = 0;    // PRECHARGE to ACTIVATE, same bank
+    uint32_t tRAS = 0;   // ACTIVATE to PRECHARGE, same bank
+    uint32_t tRC = 0;    // ACTIVATE to ACTIVATE, same bank
+    uint32_t tRRD = 0;   // ACTIVATE to ACTIVATE, different banks
+    uint32_t tWR = 0;    // WRITE to PRECHARGE, same bank
+    uint32_t tRFC = 0;   // REFRESH to any command
+    uint32_t tREFI = 0;  // maximum interval between two REFRESH
+    // Report commands not allowed in the bank state (e.g. READ on an idle bank)
+    bool check_states = false;
+};
+
+/**
+ * Command and row-buffer counters.
+ * Every READ/WRITE is either a row hit (the open row was already accessed
+ * since its ACTIVATE), a row miss (first access after activating an idle
+ * bank) or a row conflict (first access after a different row was closed).
+ */
+struct SDRAM_STATS {
+    uint64_t cycles = 0;
+    uint64_t idle_cycles = 0;
+    uint64_t activates = 0;
+    uint64_t precharges = 0;
+    uint64_t refreshes = 0;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t row_hits = 0;
+    uint64_t row_misses = 0;
+    uint64_t row_conflicts = 0;
+    uint64_t timing_violations = 0;
+
+    void dump(std::ostream& os) const {
+        os << "cycles," << cycles << std::endl
+           << "idle_cycles," << idle_cycles << std::endl
+           << "activates," << activates << std::endl
+           << "precharges," << precharges << std::endl
+           << "refreshes," << refreshes << std::endl
+           << "reads," << reads << std::endl
+           << "writes," << writes << std::endl
+           << "row_hits," << row_hits << std::endl
+           << "row_misses," << row_misses << std::endl
+           << "row_conflicts," << row_conflicts << std::endl
+           << "timing_violations," << timing_violations << std::endl;
+    }
+};
+
+/**
+ * Per-bank state machines (IDLE/ACTIVE) checking SDRAM_TIMING and filling
+ * SDRAM_STATS. The owner calls `tick` once per clock and one of the command
+ * methods for each command; violations are passed to `report` as messages.
+ */
+template<int N_BANKS>
+class SdramBankTracker {
+public:
+    static constexpr uint64_t NEVER = ~uint64_t(0);
+
+    SDRAM_TIMING timing;
+    SDRAM_STATS stats;
+
+    explicit SdramBankTracker(std::function<void(const std::string&)> report)
+        : report(report) {}
+
+    void tick(bool idle) {
+        stats.cycles++;
+        if (idle)
+            stats.idle_cycles++;
+        if (timing.tREFI && !refresh_overdue && since(last_refresh_or_start()) > timing.tREFI) {
+            refresh_overdue = true;
+            violation("tREFI", "REFRESH", 0);
+        }
+    }
+
+    void activate(uint32_t bank, uint32_t row) {
+        check_refresh("ACTIVATE");
+        Bank& b = banks[bank];
+        if (timing.check_states && b.active)
+            state_violation("ACTIVATE", bank, "active");
+        check(timing.tRP, b.precharged, "tRP", "ACTIVATE", bank);
+        check(timing.tRC, b.activated, "tRC", "ACTIVATE", bank);
+        check(timing.tRRD, last_activate, "tRRD", "ACTIVATE", bank);
+        b.conflict = b.has_row && (b.row != row);
+        b.active = true;
+        b.has_row = true;
+        b.row = row;
+        b.accessed = false;
+        b.activated = stats.cycles;
+        last_activate = stats.cycles;
+        stats.activates++;
+    }
+
+    void access(bool write, uint32_t bank, bool auto_precharge = false) {
+        const char* cmd = write ? "WRITE" : "READ";
+        check_refresh(cmd);
+        Bank& b = banks[bank];
+        if (timing.check_states && !b.active)
+            state_violation(cmd, bank, "idle");
+        check(timing.tRCD, b.activated, "tRCD", cmd, bank);
+        if (b.accessed)
+            stats.row_hits++;
+        else if (b.conflict)
+            stats.row_conflicts++;
+        else
+            stats.row_misses++;
+        b.accessed = true;
+        if (write) {
+            b.written = stats.cycles;
+            stats.writes++;
+        } else {
+            stats.reads++;
+        }
+        if (auto_precharge)
+            close(bank, false);
+    }
+
+    void precharge(uint32_t bank) {
+        check_refresh("PRECHARGE");
+        close(bank, true);
+    }
+
+    void precharge_all() {
+        check_refresh("PRECHARGE_ALL");
+        for (int i = 0; i < N_BANKS; i++)
+            close(i, true);
+    }
+
+    void refresh() {
+        check_refresh("REFRESH");
+        for (int i = 0; i < N_BANKS; i++) {
+            if (timing.check_states && banks[i].active)
+                state_violation("REFRESH", i, "active");
+            check(timing.tRP, banks[i].precharged, "tRP", "REFRESH", i);
+        }
+        last_refresh = stats.cycles;
+        refresh_overdue = false;
+        stats.refreshes++;
+    }
+
+    bool is_active(uint32_t bank) const {
+        return banks[bank].active;
+    }
+
+private:
+    struct Bank {
+        bool active = false;
+        bool has_row = false;
+        bool accessed = false;
+        bool conflict = false;
+        uint32_t row = 0;
+        uint64_t activated = NEVER;
+        uint64_t precharged = NEVER;
+        uint64_t written = NEVER;
+    };
+
+    std::function<void(const std::string&)> report;
+    Bank banks[N_BANKS];
+    uint64_t last_activate = NEVER;
+    uint64_t last_refresh = NEVER;
+    bool refresh_overdue = false;
+
+    uint64_t since(uint64_t cycle) const {
+        return stats.cycles - cycle;
+    }
+
+    uint64_t last_refresh_or_start() const {
+        return last_refresh == NEVER ? 0 : last_refresh;
+    }
+
+    void close(uint32_t bank, bool explicit_cmd) {
+        Bank& b = banks[bank];
+        if (b.active) {
+            const char* cmd = explicit_cmd ? "PRECHARGE" : "AUTO_PRECHARGE";
+            check(timing.tRAS, b.activated, "tRAS", cmd, bank);
+            check(timing.tWR, b.written, "tWR", cmd, bank);
+            stats.precharges++;
+        }
+        b.active = false;
+        b.accessed = false;
+        b.precharged = stats.cycles;
+    }
+
+    void check_refresh(const char* cmd) {
+        if (timing.tRFC && last_refresh != NEVER && since(last_refresh) < timing.tRFC)
+            violation("tRFC", cmd, 0);
+    }
+
+    void check(uint32_t limit, uint64_t last, const char* name, const char* cmd, uint32_t bank) {
+        if (limit && last != NEVER && since(last) < limit)
+            violation(name, cmd, bank);
+    }
+
+    void violation(const char* name, const char* cmd, uint32_t bank) {
+        stats.timing_violations++;
+        std::stringstream msg;
+        msg << name << " violated by " << cmd << " on bank " << bank
+            << " at cycle " << stats.cycles;
+        report(msg.str());
+    }
+
+    void state_violation(const char* cmd, uint32_t bank, const char* state) {
+        stats.timing_violations++;
+        std::stringstream msg;
+        msg << cmd << " issued to " << state << " bank " << bank
+            << " at cycle " << stats.cycles;
+        report(msg.str());
+    }
+};
+
+#endif //__SDRAM_TIMING_H__
@@ -0,0 +1,350 @@
+/**
+ * @file sparse_storage.hpp
+ * @author Riverlane, 2020
+ *
+ */
+
+#ifndef __SPARSE_STORAGE_H__
+#define __SPARSE_STORAGE_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * SparseStorage maps a 32-bit index space onto words of type T.
+ *
+ * Words are kept in pages of 2^PAGE_BITS contiguous elements, allocated on
+ * first write and reached through a two-level radix table, so an access is
+ * two indexed loads whatever the number of stored words. Words that were
+ * never written read as the `fill` value given at construction.
+ *
+ * When TRACK_INIT is set each page also keeps one bit per word telling
+ * whether it was ever written; `initialized` and `for_each_range` then
+ * only report those words (instead of the whole pages).
+ *
+ * operator[] behaves like std::map::operator[]: it allocates the page and
+ * marks the word as initialised. Use `read` for lookups without side effects.
+ */
+template<class T, unsigned int PAGE_BITS = 10, bool TRACK_INIT = false>
+class SparseStorage {
+public:
+    static constexpr unsigned int INDEX_BITS = 32;
+    static constexpr unsigned int DIR_BITS = (INDEX_BITS - PAGE_BITS + 1) / 2;
+    static constexpr unsigned int TABLE_BITS = INDEX_BITS - PAGE_BITS - DIR_BITS;
+    static constexpr uint64_t PAGE_SIZE = uint64_t(1) << PAGE_BITS;
+    static constexpr uint64_t DIR_SIZE = uint64_t(1) << DIR_BITS;
+    static constexpr uint64_t TABLE_SIZE = uint64_t(1) << TABLE_BITS;
+    static constexpr uint64_t INIT_WORDS = (PAGE_SIZE + 63) / 64;
+
+    explicit SparseStorage(const T& fill = T()) : fill_value(fill) {}
+
+    SparseStorage(const SparseStorage&) = delete;
+    SparseStorage& operator=(const SparseStorage&) = delete;
+
+    const T& fill() const {
+        return fill_value;
+    }
+
+    inline const T& read(uint32_t index) const {
+        const Page* page = find_page(index);
+        return page ? page->data[index & PAGE_MASK] : fill_value;
+    }
+
+    inline void write(uint32_t index, const T& value) {
+        Page* page = get_page(index);
+        page->data[index & PAGE_MASK] = value;
+        page->set_init(index & PAGE_MASK);
+    }
+
+    inline T& operator[](uint32_t index) {
+        Page* page = get_page(index);
+        page->set_init(index & PAGE_MASK);
+        return page->data[index & PAGE_MASK];
+    }
+
+    /**
+     * True if the word was written (TRACK_INIT) or lies in an allocated page
+     */
+    inline bool initialized(uint32_t index) const {
+        const Page* page = find_page(index);
+        return page && page->is_init(index & PAGE_MASK);
+    }
+
+    /**
+     * Writes `count` words from `src` starting at `index`
+     */
+    void write(uint32_t index, const T* src, uint64_t count) {
+        while (count) {
+            Page* page = get_page(index);
+            uint64_t offset = index & PAGE_MASK;
+            uint64_t chunk = std::min(count, PAGE_SIZE - offset);
+            std::copy(src, src + chunk, page->data + offset);
+            page->set_init(offset, chunk);
+            index += chunk;
+            src += chunk;
+            count -= chunk;
+        }
+    }
+
+    /**
+     * Reads `count` words starting at `index` into `dst`
+     */
+    void read(uint32_t index, T* dst, uint64_t count) const {
+        while (count) {
+            const Page* page = find_page(index);
+            uint64_t offset = index & PAGE_MASK;
+            uint64_t chunk = std::min(count, PAGE_SIZE - offset);
+            if (page)
+                std::copy(page->data + offset, page->data + offset + chunk, dst);
+            else
+                std::fill(dst, dst + chunk, fill_value);
+            index += chunk;
+            dst += chunk;
+            count -= chunk;
+        }
+    }
+
+    /**
+     * Sets `count` words starting at `index` to `value`
+     */
+    void fill(uint32_t index, uint64_t count, const T& value) {
+        while (count) {
+            Page* page = get_page(index);
+            uint64_t offset = index & PAGE_MASK;
+            uint64_t chunk = std::min(count, PAGE_SIZE - offset);
+            std::fill(page->data + offset, page->data + offset + chunk, value);
+            page->set_init(offset, chunk);
+            index += chunk;
+            count -= chunk;
+        }
+    }
+
+    /**
+     * Copies `count` words from `src` to `dst`; overlapping ranges are handled
+     * like memmove. Words never written in the source are copied as the fill
+     * value (and are not marked initialised when the destination page is new).
+     */
+    void copy(uint32_t dst, uint32_t src, uint64_t count) {
+        bool backward = (dst > src) && (dst - src < count);
+        uint64_t done = 0;
+        while (done < count) {
+            uint64_t remaining = count - done;
+            // Chunk bounded by the page boundaries of both ranges
+            uint32_t s, d;
+            uint64_t chunk;
+            if (backward) {
+                uint32_t s_last = src + remaining - 1;
+                uint32_t d_last = dst + remaining - 1;
+                chunk = std::min<uint64_t>({remaining, (s_last & PAGE_MASK) + 1, (d_last & PAGE_MASK) + 1});
+                s = s_last - chunk + 1;
+                d = d_last - chunk + 1;
+            } else {
+                s = src + done;
+                d = dst + done;
+                chunk = std::min<uint64_t>({remaining, PAGE_SIZE - (s & PAGE_MASK), PAGE_SIZE - (d & PAGE_MASK)});
+            }
+            const Page* from = find_page(s);
+            if (from) {
+                Page* to = get_page(d);
+                const T* first = from->data + (s & PAGE_MASK);
+                T* out = to->data + (d & PAGE_MASK);
+                if (backward)
+                    std::copy_backward(first, first + chunk, out + chunk);
+                else
+                    std::copy(first, first + chunk, out);
+                for (uint64_t i = 0; i < chunk; i++)
+                    to->assign_init((d & PAGE_MASK) + i, from->is_init((s & PAGE_MASK) + i));
+            } else if (find_page(d)) {
+                Page* to = get_page(d);
+                std::fill(to->data + (d & PAGE_MASK), to->data + (d & PAGE_MASK) + chunk, fill_value);
+                for (uint64_t i = 0; i < chunk; i++)
+                    to->assign_init((d & PAGE_MASK) + i, false);
+            }
+            done += chunk;
+        }
+    }
+
+    /**
+     * Releases every page
+     */
+    void clear() {
+        for (auto& table : directory)
+            table.reset();
+        pages = 0;
+    }
+
+    /**
+     * Resets `count` words starting at `index` to the fill value and marks them
+     * as never written; whole pages are released.
+     */
+    void clear(uint32_t index, uint64_t count) {
+        while (count) {
+            uint64_t offset = index & PAGE_MASK;
+            uint64_t chunk = std::min(count, PAGE_SIZE - offset);
+            std::unique_ptr<Table>& table = directory[index >> (PAGE_BITS + TABLE_BITS)];
+            if (table) {
+                std::unique_ptr<Page>& page = table->pages[(index >> PAGE_BITS) & TABLE_MASK];
+                if (page && chunk == PAGE_SIZE) {
+                    page.reset();
+                    pages--;
+                } else if (page) {
+                    std::fill(page->data + offset, page->data + offset + chunk, fill_value);
+                    for (uint64_t i = 0; i < chunk; i++)
+                        page->assign_init(offset + i, false);
+                }
+            }
+            index += chunk;
+            count -= chunk;
+        }
+    }
+
+    /**
+     * Calls f(first_index, const T* data, count) for each run of consecutive
+     * initialised words (allocated pages without TRACK_INIT), in index order.
+     * Runs do not cross page boundaries.
+     */
+    template<class F>
+    void for_each_range(F f) const {
+        for (uint64_t d = 0; d < DIR_SIZE; d++) {
+            if (!directory[d])
+                continue;
+            for (uint64_t t = 0; t < TABLE_SIZE; t++) {
+                const Page* page = directory[d]->pages[t].get();
+                if (!page)
+                    continue;
+                uint32_t base = uint32_t(((d << TABLE_BITS) | t) << PAGE_BITS);
+                if (!TRACK_INIT) {
+                    f(base, page->data, PAGE_SIZE);
+                    continue;
+                }
+                uint64_t i = 0;
+                while (i < PAGE_SIZE) {
+                    while (i < PAGE_SIZE && !page->is_init(i))
+                        i++;
+                    uint64_t first = i;
+                    while (i < PAGE_SIZE && page->is_init(i))
+                        i++;
+                    if (i > first)
+                        f(base + uint32_t(first), page->data + first, i - first);
+                }
+            }
+        }
+    }
+
+    /**
+     * Pointer to the page holding `index` (allocated if needed) and the number
+     * of words from `index` to the end of that page. Pages never move, so the
+     * pointer stays valid until the page is cleared.
+     */
+    T* page_pointer(uint32_t index, uint64_t& available) {
+        Page* page = get_page(index);
+        available = PAGE_SIZE - (index & PAGE_MASK);
+        return page->data + (index & PAGE_MASK);
+    }
+
+    /**
+     * Read-only variant of page_pointer: returns nullptr (and still sets
+     * `available`) when the page was never allocated.
+     */
+    const T* find_pointer(uint32_t index, uint64_t& available) const {
+        const Page* page = find_page(index);
+        available = PAGE_SIZE - (index & PAGE_MASK);
+        return page ? page->data + (index & PAGE_MASK) : nullptr;
+    }
+
+    /**
+     * Marks `count` words as written, for data stored through page_pointer
+     */
+    void set_initialized(uint32_t index, uint64_t count) {
+        while (count) {
+            Page* page = get_page(index);
+            uint64_t offset = index & PAGE_MASK;
+            uint64_t chunk = std::min(count, PAGE_SIZE - offset);
+            page->set_init(offset, chunk);
+            index += chunk;
+            count -= chunk;
+        }
+    }
+
+    size_t allocated_pages() const {
+        return pages;
+    }
+
+    /**
+     * Approximate heap footprint of the stored data
+     */
+    size_t memory_bytes() const {
+        size_t tables = 0;
+        for (const auto& table : directory)
+            tables += table ? sizeof(Table) : 0;
+        return sizeof(*this) + tables + pages * sizeof(Page);
+    }
+
+private:
+    static constexpr uint32_t PAGE_MASK = PAGE_SIZE - 1;
+    static constexpr uint32_t TABLE_MASK = TABLE_SIZE - 1;
+
+    struct Page {
+        T data[PAGE_SIZE];
+        uint64_t init[TRACK_INIT ? INIT_WORDS : 1];
+
+        explicit Page(const T& fill) {
+            std::fill(data, data + PAGE_SIZE, fill);
+            std::fill(init, init + (TRACK_INIT ? INIT_WORDS : 1), 0);
+        }
+
+        // Without tracking every word of an allocated page counts as initialised
+        inline bool is_init(uint64_t i) const {
+            return TRACK_INIT ? (init[i >> 6] >> (i & 63)) & 1 : true;
+        }
+
+        inline void set_init(uint64_t i) {
+            if (TRACK_INIT)
+                init[i >> 6] |= uint64_t(1) << (i & 63);
+        }
+
+        inline void assign_init(uint64_t i, bool value) {
+            if (TRACK_INIT) {
+                if (value)
+                    init[i >> 6] |= uint64_t(1) << (i & 63);
+                else
+                    init[i >> 6] &= ~(uint64_t(1) << (i & 63));
+            }
+        }
+
+        void set_init(uint64_t first, uint64_t count) {
+            if (TRACK_INIT)
+                for (uint64_t i = first; i < first + count; i++)
+                    set_init(i);
+        }
+    };
+
+    struct Table {
+        std::unique_ptr<Page> pages[TABLE_SIZE];
+    };
+
+    T fill_value;
+    std::unique_ptr<Table> directory[DIR_SIZE];
+    size_t pages {0};
+
+    inline const Page* find_page(uint32_t index) const {
+        const Table* table = directory[index >> (PAGE_BITS + TABLE_BITS)].get();
+        return table ? table->pages[(index >> PAGE_BITS) & TABLE_MASK].get() : nullptr;
+    }
+
+    inline Page* get_page(uint32_t index) {
+        std::unique_ptr<Table>& table = directory[index >> (PAGE_BITS + TABLE_BITS)];
+        if (!table)
+            table.reset(new Table());
+        std::unique_ptr<Page>& page = table->pages[(index >> PAGE_BITS) & TABLE_MASK];
+        if (!page) {
+            page.reset(new Page(fill_value));
+            pages++;
+        }
+        return page.get();
+    }
+};
+
+#endif //__SPARSE_STORAGE_H__
@@ -1,3 +1,5 @@
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <systemc>
 #include "models/memories/flash/N25QX.hpp"
@@ -34,7 +36,10 @@ int sc_main(int argc, char** argv) {
     std::string img_file =
         std::string("/workdir/models/memories/tests/image_for_storage.img");
     const uint32_t DUMMY_CYCLES = 11;
-    N25QX flash = N25QX("flash", DUMMY_CYCLES);
+    // The flash content lives in a (fresh) backing file
+    const char* backing_file = "/workdir/build/test_flash.bin";
+    std::remove(backing_file);
+    N25QX flash = N25QX("flash", DUMMY_CYCLES, "/workdir/build/N25QX.csv", 16*1024*1024, backing_file);
 
     flash.configure_region(img_file, 0x123456);
     flash.cs_n(cs_n);
@@ -81,10 +86,167 @@ int sc_main(int argc, char** argv) {
     std::cout << "Final string: " << content << std::endl;
     checkValuesMatch<std::string>(content, exp_str, "check");
 
-    std::cout << "Done" << std::endl;
     cs_n.write(1);
     sc_start(10, SC_NS);
 
+    // Helpers for the extended SPI commands: command on DQ0, address and
+    // data on `width` lines, single-line data out on DQ1
+    auto select = [&](uint8_t cmd) {
+        cs_n.write(0);
+        for (int i=0; i<8; i++) {
+            dq.write(cmd >>(7-i) & 0x1);
+            sc_start(1, SC_NS);
+        }
+    };
+    auto deselect = [&]() {
+        cs_n.write(1);
+        sc_start(2, SC_NS);
+    };
+    auto send = [&](uint32_t value, int bytes, int width) {
+        for (int i=bytes*8/width-1; i>=0; i--) {
+            dq.write((value >> (i*width)) & ((1 << width) - 1));
+            sc_start(1, SC_NS);
+        }
+    };
+    auto receive = [&](int width) {
+        uint8_t val = 0;
+        for (int i=0; i<8/width; i++) {
+            sc_start(1, SC_NS);
+            uint8_t lines = dq.read().to_uint();
+            lines = (width == 1) ? ((lines >> 1) & 0x1) : (lines & ((1 << width) - 1));
+            val = (val << width) | lines;
+        }
+        return val;
+    };
+    auto read_byte = [&](uint32_t address) {
+        select(0x03);
+        send(address, 3, 1);
+        uint8_t val = receive(1);
+        deselect();
+        return val;
+    };
+
+    // Single, dual and quad output reads return the same content
+    const uint8_t read_cmds[] = {0x03, 0x3b, 0x6b};
+    const int read_widths[] = {1, 2, 4};
+    for (int c=0; c<3; c++) {
+        select(read_cmds[c]);
+        send(address, 3, 1);
+        if (read_cmds[c] != 0x03)
+            sc_start((int)DUMMY_CYCLES-1, SC_NS);
+        std::string line_content;
+        for (int i=0; i<52; i++)
+            line_content.push_back((char)receive(read_widths[c]));
+        deselect();
+        checkValuesMatch<std::string>(line_content, exp_str, "multi-line read");
+    }
+
+    // Identification
+    select(0x9f);
+    checkValuesMatch<uint32_t>(receive(1), 0x20, "manufacturer id");
+    checkValuesMatch<uint32_t>(receive(1), 0xba, "memory type");
+    checkValuesMatch<uint32_t>(receive(1), 0x18, "memory capacity");
+    deselect();
+
+    // Program needs WRITE ENABLE, wraps within the page and only clears bits
+    select(0x02);
+    send(0x1000, 3, 1);
+    send(0x12, 1, 1);
+    deselect();
+    checkValuesMatch<uint32_t>(read_byte(0x1000), 0xff, "program without write enable");
+    select(0x06);
+    deselect();
+    select(0x05);
+    checkValuesMatch<uint32_t>(receive(1), 0x02, "write enable latch");
+    deselect();
+    // An unknown command is ignored and keeps the latch
+    select(0xaa);
+    deselect();
+    select(0x05);
+    checkValuesMatch<uint32_t>(receive(1), 0x02, "unknown command keeps write enable");
+    deselect();
+    select(0x02);
+    send(0x10ff, 3, 1);
+    send(0x5a, 1, 1);
+    send(0xf0, 1, 1);
+    deselect();
+    checkValuesMatch<uint32_t>(read_byte(0x10ff), 0x5a, "page program");
+    checkValuesMatch<uint32_t>(read_byte(0x1000), 0xf0, "page program wrap");
+    checkValuesMatch<uint32_t>(read_byte(0x1100), 0xff, "page program next page");
+    select(0x05);
+    checkValuesMatch<uint32_t>(receive(1), 0x00, "write enable latch cleared");
+    deselect();
+
+    // Subsector erase
+    select(0x06);
+    deselect();
+    select(0x20);
+    send(0x1abc, 3, 1);
+    deselect();
+    checkValuesMatch<uint32_t>(read_byte(0x1000), 0xff, "subsector erase");
+    checkValuesMatch<uint32_t>(read_byte(0x10ff), 0xff, "subsector erase");
+
+    // 4-byte addressing
+    select(0xb7);
+    deselect();
+    select(0x70);
+    checkValuesMatch<uint32_t>(receive(1), 0x81, "flag status in 4-byte mode");
+    deselect();
+    select(0x03);
+    send(address, 4, 1);
+    checkValuesMatch<uint32_t>(receive(1), (uint8_t)exp_str[0], "4-byte address read");
+    deselect();
+    select(0xe9);
+    deselect();
+
+    // XIP reads through the TLM socket share the array with the pins
+    flash.xip_clock_period = sc_time(10, SC_NS);
+    std::vector<uint8_t> line(52);
+    tlm::tlm_generic_payload trans;
+    sc_time delay = SC_ZERO_TIME;
+    trans.set_command(tlm::TLM_READ_COMMAND);
+    trans.set_address(address);
+    trans.set_data_ptr(line.data());
+    trans.set_data_length(line.size());
+    trans.set_streaming_width(line.size());
+    trans.set_byte_enable_ptr(0);
+    trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+    flash.b_transport(trans, delay);
+    checkValuesMatch<bool>(trans.is_response_ok(), true, "xip_read");
+    checkValuesMatch<std::string>(std::string(line.begin(), line.end()), exp_str, "xip_read_content");
+    // command + 6 address nibbles + dummy + 2 clocks per byte
+    checkValuesMatch<sc_time>(delay, sc_time(10 * (8 + 6 + DUMMY_CYCLES - 1 + 2 * 52), SC_NS), "xip_delay");
+
+    trans.set_command(tlm::TLM_WRITE_COMMAND);
+    trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+    flash.b_transport(trans, delay);
+    checkValuesMatch<bool>(trans.get_response_status() == tlm::TLM_COMMAND_ERROR_RESPONSE, true, "xip_write");
+
+    tlm::tlm_dmi dmi;
+    trans.set_command(tlm::TLM_READ_COMMAND);
+    checkValuesMatch<bool>(flash.get_direct_mem_ptr(trans, dmi), true, "xip_dmi");
+    checkValuesMatch<bool>(dmi.is_write_allowed(), false, "xip_dmi_read_only");
+    checkValuesMatch<uint64_t>(dmi.get_end_address(), flash.size - 1, "xip_dmi_end");
+    checkValuesMatch<uint32_t>(dmi.get_dmi_ptr()[address], (uint8_t)exp_str[0], "xip_dmi_content");
+
+    uint8_t patch = 0x42;
+    trans.set_command(tlm::TLM_WRITE_COMMAND);
+    trans.set_address(0x3000);
+    trans.set_data_ptr(&patch);
+    trans.set_data_length(1);
+    checkValuesMatch<unsigned int>(flash.transport_dbg(trans), 1, "dbg_write");
+    checkValuesMatch<uint32_t>(read_byte(0x3000), 0x42, "dbg_write_pin_read");
+
+    // Loads, programs and erases went to the backing file
+    std::ifstream backing(backing_file, std::ios::binary);
+    std::string file_content((std::istreambuf_iterator<char>(backing)), std::istreambuf_iterator<char>());
+    checkValuesMatch<uint64_t>(file_content.size(), flash.size, "backing_file_size");
+    checkValuesMatch<std::string>(file_content.substr(address, exp_str.size()), exp_str, "backing_file_image");
+    checkValuesMatch<uint32_t>((uint8_t)file_content[0x3000], 0x42, "backing_file_write");
+    checkValuesMatch<uint32_t>((uint8_t)file_content[0x1000], 0xff, "backing_file_erase");
+
+    std::cout << "Done" << std::endl;
+
     sc_close_vcd_trace_file(Tf);
 
 
@@ -0,0 +1,158 @@
+#include <iostream>
+#include <fstream>
+#include <map>
+#include "systemc.h"
+#include "commons/assertions.hpp"
+#include "models/memories/loaders/image_loader.hpp"
+
+using namespace std;
+
+typedef std::map<uint64_t, uint8_t> ByteMap;
+
+static void write_file(const std::string& name, const std::string& content) {
+    std::ofstream os(name, std::ofstream::binary);
+    os << content;
+}
+
+static std::string hex_record(const std::vector<uint8_t>& bytes, uint8_t checksum) {
+    static const char digits[] = "0123456789ABCDEF";
+    std::string out;
+    for (uint8_t b : bytes) {
+        out += digits[b >> 4];
+        out += digits[b & 0xf];
+    }
+    out += digits[checksum >> 4];
+    out += digits[checksum & 0xf];
+    return out + "\n";
+}
+
+static std::string ihex(uint16_t address, uint8_t type, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> bytes {uint8_t(data.size()), uint8_t(address >> 8), uint8_t(address), type};
+    bytes.insert(bytes.end(), data.begin(), data.end());
+    uint8_t sum = 0;
+    for (uint8_t b : bytes)
+        sum += b;
+    return ":" + hex_record(bytes, uint8_t(-sum));
+}
+
+static std::string srec(char type, uint32_t address, int addr_len, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> bytes {uint8_t(addr_len + data.size() + 1)};
+    for (int i = addr_len - 1; i >= 0; i--)
+        bytes.push_back(uint8_t(address >> (8 * i)));
+    bytes.insert(bytes.end(), data.begin(), data.end());
+    uint8_t sum = 0;
+    for (uint8_t b : bytes)
+        sum += b;
+    return std::string("S") + type + hex_record(bytes, uint8_t(~sum));
+}
+
+static void put_be(std::string& s, size_t pos, uint64_t v, int size) {
+    for (int i = 0; i < size; i++)
+        s[pos + i] = char(v >> (8 * (size - 1 - i)));
+}
+
+static ByteMap load(const std::string& name, uint64_t raw_address, bool expect_ok = true, uint64_t skip = 0) {
+    ByteMap bytes;
+    std::string error;
+    bool ok = load_image(name, raw_address, [&](uint64_t address, const uint8_t* data, uint64_t len) {
+        for (uint64_t i = 0; i < len; i++)
+            bytes[address + i] = data[i];
+    }, error, ImageFormat::AUTO, skip);
+    checkValuesMatch<bool>(ok, expect_ok, name.c_str());
+    return bytes;
+}
+
+void test_bswap() {
+    uint8_t src[4 * 11 + 1];
+    for (unsigned int i = 0; i < sizeof(src); i++)
+        src[i] = i;
+    uint32_t dst[11];
+    // Unaligned source
+    bswap32_copy(dst, src + 1, 11);
+    for (int i = 0; i < 11; i++)
+        checkValuesMatch<uint32_t>(dst[i], (src[1 + 4 * i] << 24) | (src[2 + 4 * i] << 16) |
+                                   (src[3 + 4 * i] << 8) | src[4 + 4 * i], "bswap32_copy");
+}
+
+void test_raw() {
+    write_file("/workdir/build/loader.bin", "0123456789");
+    ByteMap bytes = load("/workdir/build/loader.bin", 0x1000, true, 2);
+    checkValuesMatch<size_t>(bytes.size(), 8, "raw_size");
+    checkValuesMatch<uint32_t>(bytes[0x1000], '2', "raw_skip");
+    checkValuesMatch<uint32_t>(bytes[0x1007], '9', "raw_last");
+
+    // Looks like Intel HEX, but a .bin is always raw
+    write_file("/workdir/build/loader_colon.bin", ":0100000001FF\n");
+    bytes = load("/workdir/build/loader_colon.bin", 0);
+    checkValuesMatch<size_t>(bytes.size(), 14, "raw_colon_size");
+    checkValuesMatch<uint32_t>(bytes[0], ':', "raw_colon");
+}
+
+void test_ihex() {
+    std::string image = ihex(0, 0x04, {0x12, 0x34}) +
+                        ihex(0xFFFE, 0x00, {0xAA, 0xBB}) +
+                        ihex(0, 0x02, {0x10, 0x00}) +
+                        ihex(0x0010, 0x00, {0xCC}) +
+                        ihex(0, 0x01, {});
+    write_file("/workdir/build/loader.hex", image);
+    ByteMap bytes = load("/workdir/build/loader.hex", 0);
+    checkValuesMatch<size_t>(bytes.size(), 3, "ihex_size");
+    checkValuesMatch<uint32_t>(bytes[0x1234FFFF], 0xBB, "ihex_linear");
+    checkValuesMatch<uint32_t>(bytes[0x10010], 0xCC, "ihex_segment");
+
+    write_file("/workdir/build/loader_bad.hex", ":0100000001FF\n");
+    load("/workdir/build/loader_bad.hex", 0, false);
+
+    // Extended address records carry exactly two bytes
+    write_file("/workdir/build/loader_short.hex", ihex(0, 0x04, {0x12}) + ihex(0, 0x01, {}));
+    load("/workdir/build/loader_short.hex", 0, false);
+}
+
+void test_srec() {
+    std::string image = srec('0', 0, 2, {'h', 'i'}) +
+                        srec('1', 0x1234, 2, {1, 2}) +
+                        srec('3', 0x80000000, 4, {3, 4, 5}) +
+                        srec('7', 0, 4, {});
+    write_file("/workdir/build/loader.srec", image);
+    ByteMap bytes = load("/workdir/build/loader.srec", 0);
+    checkValuesMatch<size_t>(bytes.size(), 5, "srec_size");
+    checkValuesMatch<uint32_t>(bytes[0x1235], 2, "srec_s1");
+    checkValuesMatch<uint32_t>(bytes[0x80000002], 5, "srec_s3");
+}
+
+void test_elf() {
+    // Big-endian ELF32 with a PT_LOAD segment (2 bytes + 3 of .bss) and a PT_NOTE
+    std::string image(52 + 2 * 32 + 2, '\0');
+    image[0] = 0x7f; image[1] = 'E'; image[2] = 'L'; image[3] = 'F';
+    image[4] = 1; image[5] = 2; image[6] = 1;
+    put_be(image, 28, 52, 4);
+    put_be(image, 42, 32, 2);
+    put_be(image, 44, 2, 2);
+    size_t ph = 52;
+    put_be(image, ph + 0, 1, 4);
+    put_be(image, ph + 4, 52 + 64, 4);
+    put_be(image, ph + 8, 0x1000, 4);
+    put_be(image, ph + 12, 0x40001000, 4);
+    put_be(image, ph + 16, 2, 4);
+    put_be(image, ph + 20, 5, 4);
+    put_be(image, ph + 32, 4, 4);
+    put_be(image, ph + 32 + 4, 0, 4);
+    image[52 + 64] = 0x5A;
+    image[52 + 65] = 0xA5;
+    write_file("/workdir/build/loader.elf", image);
+    ByteMap bytes = load("/workdir/build/loader.elf", 0);
+    checkValuesMatch<size_t>(bytes.size(), 5, "elf_size");
+    checkValuesMatch<uint32_t>(bytes[0x40001001], 0xA5, "elf_data");
+    checkValuesMatch<uint32_t>(bytes[0x40001004], 0, "elf_bss");
+}
+
+int sc_main(int argc, char* argv[]) {
+    test_bswap();
+    test_raw();
+    test_ihex();
+    test_srec();
+    test_elf();
+    load("/workdir/build/does_not_exist.bin", 0, false);
+    cout << "Image loader test completed" << endl;
+    return 0;
+}
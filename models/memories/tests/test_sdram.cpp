@@ -66,6 +66,19 @@ struct MockDDRController: sc_module
        sc_start(1, SC_NS);
    }
 
+   void load_mode(uint32_t mode){
+       cs_n.write(0);
+       a.write(mode);
+       ba.write(0);
+       cke.write(1);
+       ras_n.write(0);
+       cas_n.write(0);
+       we_n.write(0);
+       sc_start(1, SC_NS);
+       do_nop();
+       sc_start(1, SC_NS);
+   }
+
    uint32_t do_read(uint32_t bank, uint32_t col){
        cs_n.write(0);
        a.write(col);
@@ -164,6 +177,251 @@ void test_interleaved_sequence(GENERIC_SDRAM<12,2>& sdram, MockDDRController<12,
     sdram.mem.clear();
 }
 
+void test_backdoor(GENERIC_SDRAM<12,2>& sdram, sc_signal<sc_bv<32>>& copy_from,
+                   sc_signal<sc_bv<32>>& copy_to, sc_signal<sc_bv<32>>& copy_size,
+                   sc_signal<sc_bv<1>>& copy, sc_signal<sc_bv<32>>& clear_from,
+                   sc_signal<sc_bv<32>>& clear_to, sc_signal<sc_bv<1>>& clear){
+    const uint32_t base = 0x40000000;
+    for (uint32_t i = 0; i < 0x100; i++)
+        sdram.mem[0x1000/4 + i] = i;
+
+    // Instantaneous copy (default)
+    copy_from.write(base + 0x1000);
+    copy_to.write(base + 0x2000);
+    copy_size.write(0x400);
+    copy.write(1);
+    sc_start(1, SC_NS);
+    copy.write(0);
+    sc_start(1, SC_NS);
+    checkValuesMatch<uint32_t>(sdram.mem.read(0x2000/4 + 0xff), 0xff, "backdoor_copy");
+
+    // Modelled duration: one word per ns, data moves on completion
+    sdram.backdoor_word_time = sc_time(1, SC_NS);
+    clear_from.write(base + 0x2000);
+    clear_to.write(base + 0x2040);
+    clear.write(1);
+    sc_start(1, SC_NS);
+    clear.write(0);
+    checkValuesMatch<bool>(sdram.backdoor_busy.read(), true, "backdoor_busy");
+    checkValuesMatch<uint32_t>(sdram.mem.read(0x2000/4 + 1), 1, "backdoor_clear_pending");
+    sc_start(16, SC_NS);
+    checkValuesMatch<bool>(sdram.backdoor_busy.read(), false, "backdoor_idle");
+    checkValuesMatch<uint32_t>(sdram.mem.read(0x2000/4 + 1), 0, "backdoor_clear");
+    checkValuesMatch<uint32_t>(sdram.mem.read(0x2040/4), 0x10, "backdoor_clear_bounds");
+    sdram.backdoor_word_time = SC_ZERO_TIME;
+    sdram.mem.clear();
+}
+
+void test_tlm_front_door(GENERIC_SDRAM<12,2>& sdram, MockDDRController<12,2>& mock){
+    const uint32_t base = 0x40000000;
+    tlm::tlm_generic_payload trans;
+    sc_time delay = SC_ZERO_TIME;
+    uint32_t data = 0xDEADBEEF;
+
+    // TLM write, pin-level read
+    trans.set_command(tlm::TLM_WRITE_COMMAND);
+    trans.set_address(base + 0x1230);
+    trans.set_data_ptr(reinterpret_cast<unsigned char*>(&data));
+    trans.set_data_length(4);
+    trans.set_streaming_width(4);
+    trans.set_byte_enable_ptr(0);
+    trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+    sdram.b_transport(trans, delay);
+    checkValuesMatch<bool>(trans.is_response_ok(), true, "tlm_write");
+    mock.do_nop();
+    sc_start(5, SC_NS);
+    checkValuesMatch<uint32_t>(_read(sdram, mock, 0x1230), 0xDEADBEEF, "tlm_write_pin_read");
+
+    // Pin-level write, TLM read of a burst straddling the written word
+    mock.do_nop();
+    sc_start(5, SC_NS);
+    _write(sdram, mock, 0x2004, 0x12345678);
+    uint32_t burst[3] = {1, 1, 1};
+    trans.set_command(tlm::TLM_READ_COMMAND);
+    trans.set_address(base + 0x2000);
+    trans.set_data_ptr(reinterpret_cast<unsigned char*>(burst));
+    trans.set_data_length(12);
+    trans.set_streaming_width(12);
+    trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+    sdram.b_transport(trans, delay);
+    checkValuesMatch<uint32_t>(burst[0], 0, "tlm_read_unwritten");
+    checkValuesMatch<uint32_t>(burst[1], 0x12345678, "tlm_read_pin_write");
+
+    // Outside of the device
+    trans.set_address(base - 4);
+    trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+    sdram.b_transport(trans, delay);
+    checkValuesMatch<bool>(trans.get_response_status() == tlm::TLM_ADDRESS_ERROR_RESPONSE, true, "tlm_address_error");
+
+    // DMI covers the storage page and aliases the pin-level view
+    tlm::tlm_dmi dmi;
+    trans.set_command(tlm::TLM_READ_COMMAND);
+    trans.set_address(base + 0x3000);
+    checkValuesMatch<bool>(sdram.get_direct_mem_ptr(trans, dmi), true, "dmi_read_granted");
+    checkValuesMatch<bool>(dmi.is_write_allowed(), false, "dmi_read_only");
+    checkValuesMatch<bool>(sdram.mem.initialized(0x3000/4), false, "dmi_read_uninitialized");
+    trans.set_command(tlm::TLM_WRITE_COMMAND);
+    trans.set_address(base + 0x2008);
+    checkValuesMatch<bool>(sdram.get_direct_mem_ptr(trans, dmi), true, "dmi_granted");
+    checkValuesMatch<bool>(dmi.is_read_write_allowed(), true, "dmi_read_write");
+    checkValuesMatch<uint64_t>(dmi.get_start_address(), base + 0x2008, "dmi_start");
+    checkValuesMatch<uint64_t>(dmi.get_end_address(), base + 0x2FFF, "dmi_end");
+    reinterpret_cast<uint32_t*>(dmi.get_dmi_ptr())[1] = 0xCAFEF00D;
+    checkValuesMatch<uint32_t>(sdram.mem.read(0x200C/4), 0xCAFEF00D, "dmi_write");
+
+    // Debug access
+    uint8_t bytes[2];
+    trans.set_command(tlm::TLM_READ_COMMAND);
+    trans.set_address(base + 0x2005);
+    trans.set_data_ptr(bytes);
+    trans.set_data_length(2);
+    checkValuesMatch<unsigned int>(sdram.transport_dbg(trans), 2, "dbg_read");
+    checkValuesMatch<uint32_t>(bytes[0] | (bytes[1] << 8), 0x3456, "dbg_read_bytes");
+    sdram.invalidate_dmi();
+    sdram.mem.clear();
+}
+
+void test_bank_model(){
+    std::vector<std::string> reports;
+    SdramBankTracker<4> model([&](const std::string& msg) { reports.push_back(msg); });
+    model.timing.tRCD = 2;
+    model.timing.tRP = 2;
+    model.timing.check_states = true;
+
+    model.tick(false);
+    model.activate(0, 5);
+    model.tick(true);
+    model.tick(false);
+    model.access(false, 0);          // miss
+    model.tick(false);
+    model.access(true, 0);           // hit
+    model.tick(false);
+    model.precharge(0);
+    model.tick(false);
+    model.activate(0, 6);            // tRP violated
+    model.tick(false);
+    model.access(false, 0);          // conflict, tRCD violated
+    model.tick(false);
+    model.access(false, 1);          // bank 1 is idle
+    checkValuesMatch<uint64_t>(model.stats.cycles, 8, "bank_model_cycles");
+    checkValuesMatch<uint64_t>(model.stats.idle_cycles, 1, "bank_model_idle");
+    checkValuesMatch<uint64_t>(model.stats.activates, 2, "bank_model_activates");
+    checkValuesMatch<uint64_t>(model.stats.precharges, 1, "bank_model_precharges");
+    checkValuesMatch<uint64_t>(model.stats.row_hits, 1, "bank_model_hits");
+    checkValuesMatch<uint64_t>(model.stats.row_misses, 2, "bank_model_misses");
+    checkValuesMatch<uint64_t>(model.stats.row_conflicts, 1, "bank_model_conflicts");
+    checkValuesMatch<uint64_t>(model.stats.timing_violations, 3, "bank_model_violations");
+    checkValuesMatch<size_t>(reports.size(), 3, "bank_model_reports");
+}
+
+void test_row_stats(GENERIC_SDRAM<12,2>& sdram, MockDDRController<12,2>& mock){
+    SDRAM_STATS before = sdram.bank_model.stats;
+    mock.do_nop();
+    sc_start(5, SC_NS);
+    _write(sdram, mock, 0x4000, 0x1);
+    mock.do_write(0, 1, 0x2);
+    SDRAM_STATS after = sdram.bank_model.stats;
+    checkValuesMatch<uint64_t>(after.activates - before.activates, 1, "row_stats_activates");
+    checkValuesMatch<uint64_t>(after.writes - before.writes, 2, "row_stats_writes");
+    checkValuesMatch<uint64_t>(after.row_hits - before.row_hits, 1, "row_stats_hits");
+    checkValuesMatch<bool>(after.idle_cycles > before.idle_cycles, true, "row_stats_idle");
+    sdram.mem.clear();
+}
+
+void test_read_pipeline(GENERIC_SDRAM<12,2>& sdram, MockDDRController<12,2>& mock){
+    uint32_t row, bank, col;
+    sdram.to_row_bank_column(0x5000, row, bank, col);
+    for (uint32_t i = 0; i < 4; i++)
+        sdram.mem.write(0x5000/4 + i, 0xA0 + i);
+
+    // CL=2, BL=4, sequential bursts
+    mock.do_nop();
+    sc_start(5, SC_NS);
+    mock.load_mode(0x022);
+    checkValuesMatch<unsigned int>(sdram.cas_latency, 2, "mode_cl");
+    checkValuesMatch<unsigned int>(sdram.burst_length, 4, "mode_bl");
+    mock.activate_bank(bank, row);
+    // The burst starts at column 2 and wraps inside the 4-word block
+    uint32_t first = mock.do_read(bank, col + 2);
+    checkValuesMatch<bool>(first != 0xA2, true, "cl2_not_after_one_cycle");
+    std::vector<uint32_t> beats;
+    for (int i = 0; i < 4; i++) {
+        sc_start(1, SC_NS);
+        beats.push_back(mock.dq.read().to_uint());
+    }
+    std::vector<uint32_t> expected {0xA2, 0xA3, 0xA0, 0xA1};
+    checkValuesMatch<uint32_t>(beats, expected, "read_burst");
+
+    // BL=2 write burst: the second beat comes from the following NOP (dq=0)
+    mock.load_mode(0x021);
+    mock.activate_bank(bank, row);
+    mock.do_write(bank, col + 1, 0xBEEF);
+    checkValuesMatch<uint32_t>(sdram.mem.read(0x5000/4 + 1), 0xBEEF, "write_burst_first");
+    checkValuesMatch<uint32_t>(sdram.mem.read(0x5000/4), 0, "write_burst_wrap");
+    checkValuesMatch<uint32_t>(sdram.mem.read(0x5000/4 + 2), 0xA2, "write_burst_bounds");
+
+    // Back to CL=1, BL=1
+    mock.load_mode(0x010);
+    sdram.mem.clear();
+}
+
+void test_checkpoint(GENERIC_SDRAM<12,2>& sdram){
+    sdram.mem.write(0x10/4, 0x01020304);
+    sdram.mem.write(0x14/4, 0xa0b0c0d0);
+    sdram.mem.write(0x18/4, 0x11);
+    sdram.mem.write(0x1c/4, 0x22);
+    sdram.mem.write(0x100/4, 0xdeadbeef);
+    for (uint32_t i = 0; i < 3000; i++)
+        sdram.mem.write(0x200000/4 + i, i * 7);
+
+    sdram.hexdump("/workdir/build/sdram_checkpoint.hexdump");
+    std::ifstream dump("/workdir/build/sdram_checkpoint.hexdump");
+    std::string line1, line2, line3;
+    std::getline(dump, line1);
+    std::getline(dump, line2);
+    std::getline(dump, line3);
+    checkValuesMatch<std::string>(line1, "", "hexdump_leading_jump");
+    checkValuesMatch<std::string>(line2, "00000010 01 02 03 04 a0 b0 c0 d0 00 00 00 11 00 00 00 22", "hexdump_line");
+    checkValuesMatch<std::string>(line3, "", "hexdump_jump");
+
+    sdram.checkpoint("/workdir/build/sdram.ckpt");
+    sdram.mem.clear();
+    sdram.mem.write(0x40/4, 0x1234);
+    sdram.restore("/workdir/build/sdram.ckpt");
+    checkValuesMatch<bool>(sdram.mem.initialized(0x40/4), false, "restore_replaces");
+    checkValuesMatch<uint32_t>(sdram.mem.read(0x14/4), 0xa0b0c0d0, "restore_word");
+    checkValuesMatch<uint32_t>(sdram.mem.read(0x100/4), 0xdeadbeef, "restore_isolated_word");
+    checkValuesMatch<uint32_t>(sdram.mem.read(0x200000/4 + 2999), 2999 * 7, "restore_range");
+    checkValuesMatch<bool>(sdram.mem.initialized(0x20/4), false, "restore_unwritten");
+
+    // Broken checkpoints are rejected and leave the content untouched
+    std::ifstream in("/workdir/build/sdram.ckpt", std::ios::binary);
+    std::string ckpt((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::string truncated = ckpt.substr(0, ckpt.size() - 4);
+    std::string outside = ckpt;
+    uint32_t start = 0xFFFFFFF0;
+    memcpy(&outside[sizeof(SDRAM_CHECKPOINT_HEADER)], &start, sizeof(start));
+    // Corrupted headers: CAS latency 0, burst length 3
+    std::string bad_cl = ckpt;
+    std::string bad_bl = ckpt;
+    uint32_t value = 0;
+    memcpy(&bad_cl[offsetof(SDRAM_CHECKPOINT_HEADER, cas_latency)], &value, sizeof(value));
+    value = 3;
+    memcpy(&bad_bl[offsetof(SDRAM_CHECKPOINT_HEADER, burst_length)], &value, sizeof(value));
+    for (const std::string& broken : {truncated, outside, bad_cl, bad_bl}) {
+        std::ofstream("/workdir/build/sdram_broken.ckpt", std::ios::binary) << broken;
+        bool restored = true;
+        try {
+            restored = sdram.restore("/workdir/build/sdram_broken.ckpt");
+        } catch (const sc_core::sc_report& ex) {
+            restored = false;
+        }
+        checkValuesMatch<bool>(restored, false, "restore_broken");
+        checkValuesMatch<uint32_t>(sdram.mem.read(0x200000/4 + 2999), 2999 * 7, "restore_broken_untouched");
+    }
+    sdram.mem.clear();
+}
+
 
 int sc_main(int argc, char** argv) {
 
@@ -251,6 +509,13 @@ int sc_main(int argc, char** argv) {
       test_addressing(sdram);
       test_simple_sequence(sdram, mock);
       test_interleaved_sequence(sdram, mock);
+      test_tlm_front_door(sdram, mock);
+      test_bank_model();
+      test_row_stats(sdram, mock);
+      test_read_pipeline(sdram, mock);
+      test_checkpoint(sdram);
+      test_backdoor(sdram, backdoor_copy_from, backdoor_copy_to, backdoor_copy_size,
+                    backdoor_copy, backdoor_clear_from, backdoor_clear_to, backdoor_clear);
     } catch (const std::exception& ex) {
       std::cerr << "One of the test failed - rethrowing exception after saving wave files" << std::endl;
       sc_close_vcd_trace_file(Tf);
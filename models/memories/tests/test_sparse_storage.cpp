@@ -0,0 +1,87 @@
+#include <iostream>
+#include "systemc.h"
+#include "commons/assertions.hpp"
+#include "models/memories/storage/sparse_storage.hpp"
+
+using namespace std;
+
+int sc_main(int argc, char* argv[]) {
+    SparseStorage<uint32_t> plain;
+    typedef SparseStorage<uint32_t> Plain;
+
+    // Unwritten words read as the fill value without allocating
+    checkValuesMatch<uint32_t>(plain.read(0x12345678), 0, "read_unwritten");
+    checkValuesMatch<size_t>(plain.allocated_pages(), 0, "no_pages_on_read");
+
+    plain.write(0xFFFFFFFF, 0xcafe);
+    plain[0x10] = 0xbabe;
+    checkValuesMatch<uint32_t>(plain.read(0xFFFFFFFF), 0xcafe, "write_top");
+    checkValuesMatch<uint32_t>(plain.read(0x10), 0xbabe, "write_operator");
+    checkValuesMatch<size_t>(plain.allocated_pages(), 2, "two_pages");
+
+    // Bulk write and read across a page boundary
+    std::vector<uint32_t> src(3000), dst(3000);
+    for (size_t i = 0; i < src.size(); i++)
+        src[i] = i * 3 + 1;
+    plain.write(Plain::PAGE_SIZE - 100, src.data(), src.size());
+    plain.read(Plain::PAGE_SIZE - 100, dst.data(), dst.size());
+    checkValuesMatch<uint32_t>(dst, src, "bulk_write_read");
+
+    // Overlapping copies behave like memmove
+    plain.copy(Plain::PAGE_SIZE, Plain::PAGE_SIZE - 100, 2000);
+    for (uint32_t i = 0; i < 2000; i++)
+        checkValuesMatch<uint32_t>(plain.read(Plain::PAGE_SIZE + i), src[i], "copy_forward_overlap");
+    plain.copy(Plain::PAGE_SIZE - 50, Plain::PAGE_SIZE, 2000);
+    for (uint32_t i = 0; i < 2000; i++)
+        checkValuesMatch<uint32_t>(plain.read(Plain::PAGE_SIZE - 50 + i), src[i], "copy_backward_overlap");
+
+    // Copying from an unwritten area clears the destination
+    plain.copy(Plain::PAGE_SIZE, 0x80000000, 10);
+    checkValuesMatch<uint32_t>(plain.read(Plain::PAGE_SIZE + 5), 0, "copy_unwritten");
+    checkValuesMatch<size_t>(plain.allocated_pages(), 5, "copy_no_source_pages");
+
+    plain.fill(0x100000, 5000, 0xAA55);
+    checkValuesMatch<uint32_t>(plain.read(0x100000 + 4999), 0xAA55, "fill");
+    checkValuesMatch<uint32_t>(plain.read(0x100000 + 5000), 0, "fill_bounds");
+
+    // Clearing whole pages releases them
+    size_t pages = plain.allocated_pages();
+    plain.clear(0x100000, 2 * Plain::PAGE_SIZE);
+    checkValuesMatch<size_t>(plain.allocated_pages(), pages - 2, "clear_range_pages");
+    checkValuesMatch<uint32_t>(plain.read(0x100000 + 2 * Plain::PAGE_SIZE), 0xAA55, "clear_range_bounds");
+    plain.clear();
+    checkValuesMatch<size_t>(plain.allocated_pages(), 0, "clear_all");
+    checkValuesMatch<uint32_t>(plain.read(0x10), 0, "clear_all_read");
+
+    // Tracking initialised words
+    SparseStorage<uint8_t, 10, true> tracked(0xFF);
+    tracked.write(0x2000, 0x11);
+    tracked.fill(0x2003, 3, 0x22);
+    tracked.write(0x9000, 0x33);
+    checkValuesMatch<bool>(tracked.initialized(0x2000), true, "init_written");
+    checkValuesMatch<bool>(tracked.initialized(0x2001), false, "init_same_page");
+    checkValuesMatch<uint32_t>(tracked.read(0x2001), 0xFF, "init_fill_value");
+
+    std::vector<uint32_t> ranges;
+    tracked.for_each_range([&](uint32_t first, const uint8_t* data, uint64_t count) {
+        ranges.push_back(first);
+        ranges.push_back(count);
+        ranges.push_back(data[0]);
+    });
+    std::vector<uint32_t> expected {0x2000, 1, 0x11, 0x2003, 3, 0x22, 0x9000, 1, 0x33};
+    checkValuesMatch<uint32_t>(ranges, expected, "ranges");
+
+    tracked.clear(0x2004, 1);
+    checkValuesMatch<bool>(tracked.initialized(0x2004), false, "clear_word_init");
+    checkValuesMatch<uint32_t>(tracked.read(0x2004), 0xFF, "clear_word_value");
+
+    // Pages never move, so their pointers can be handed out for DMI
+    uint64_t available;
+    uint8_t* ptr = tracked.page_pointer(0x2010, available);
+    checkValuesMatch<uint64_t>(available, 1024 - 0x10, "page_pointer_size");
+    ptr[1] = 0x44;
+    checkValuesMatch<uint32_t>(tracked.read(0x2011), 0x44, "page_pointer_write");
+
+    cout << "Sparse storage test completed" << endl;
+    return 0;
+}
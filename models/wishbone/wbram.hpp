@@ -8,7 +8,11 @@
 #define __WBRAM_H__
 
 #include "systemc"
-#include <map>
+#include <cstdint>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+#include "tlms/commons/wishbone_burst.hpp"
 
 using namespace std;
 
@@ -17,10 +21,33 @@ using namespace std;
  *
  * This blocks represents a simple memory exposed to a single `DWIDTH`-wide wishbone bus
  *  SIZE defines the size of the Memory.
+ * Words are kept in a dense array of native integers; a valid bit per word
+ * tells which ones were written, the others read as all 'X'.
+ * Accesses are only printed when `verbose` is set.
+ *
+ * Classic cycles support registered feedback bursts: while cti_i announces
+ * a constant or incrementing (linear or wrapping, see bte_i) burst the next
+ * word is acknowledged on the following clock, without waiting for the
+ * master to present its address. In pipelined mode (setPipelined) every
+ * strobe is a new request, acknowledged one clock later. setStallPeriod(n)
+ * makes the memory busy one clock out of n: stall_o is raised the clock
+ * before, and the request on the bus at that clock is left for the master
+ * to hold.
+ * cti_i, bte_i and stall_o may be left unbound (classic cycles, no stalls).
  */
 template <int DWIDTH>
 struct WBRAM: sc_module
 {
+    static_assert(DWIDTH % 8 == 0 && DWIDTH <= 64, "WBRAM supports byte multiples up to 64 bits");
+
+    // Smallest native integer holding a word
+    typedef typename std::conditional<DWIDTH <= 8, uint8_t,
+            typename std::conditional<DWIDTH <= 16, uint16_t,
+            typename std::conditional<DWIDTH <= 32, uint32_t, uint64_t>::type>::type>::type word_t;
+    static constexpr int SEL_WIDTH = DWIDTH / 8;
+    // Words are allocated up front: a block RAM model has no use for more
+    static constexpr uint64_t MAX_WORDS = uint64_t(1) << 28;
+
     sc_in_clk clk_i;
     sc_in<bool> rst_i;
     sc_in<sc_bv<DWIDTH>> adr_i;
@@ -31,78 +58,174 @@ struct WBRAM: sc_module
     sc_in<sc_bv<DWIDTH/8>> sel_i;
     sc_out<bool> ack_o;
     sc_out<sc_bv<DWIDTH>> dat_o;
-
-    std::map<int32_t, sc_bv<DWIDTH>> memory;
+    sc_port<sc_signal_in_if<sc_bv<3>>, 1, SC_ZERO_OR_MORE_BOUND> cti_i;
+    sc_port<sc_signal_in_if<sc_bv<2>>, 1, SC_ZERO_OR_MORE_BOUND> bte_i;
+    sc_port<sc_signal_inout_if<bool>, 1, SC_ZERO_OR_MORE_BOUND> stall_o;
+
+    std::vector<word_t> memory;
+    // One bit per word, set once the word is written
+    std::vector<uint64_t> valid;
+    // Byte lane mask of every sel_i value
+    word_t sel_mask[1 << SEL_WIDTH];
+    const sc_bv<DWIDTH> undefined;
     sc_bv<DWIDTH> word;
     sc_bv<DWIDTH> word_in;
     bool n_tran = false;
+    // Registered feedback burst: address of the word acknowledged last, and
+    // a write acknowledged before its data was on the bus
+    uint32_t burst_adr {0};
+    bool write_pending {false};
 
     uint32_t mem_size;
+    bool verbose;
+    bool pipelined {false};
+    unsigned int stall_period {0};
+    unsigned int stall_count {0};
 
     // Debug signals
     sc_signal<long int> db_wr_ops;
     sc_signal<long int> db_rd_ops;
 
 
-    sc_bv<DWIDTH> retrieve_word(uint32_t address) {
+    static sc_bv<DWIDTH> undefined_word() {
+        // uninitialized memory location, returning XXX;
         sc_bv<DWIDTH> w;
+        for (int i=0; i < DWIDTH; i++)
+            w.set_bit(i, 'X');
+        return w;
+    }
+
+    bool is_valid(uint32_t address) const {
+        return (valid[address >> 6] >> (address & 63)) & 1;
+    }
+
+    sc_bv<DWIDTH> retrieve_word(uint32_t address) {
         if (address > mem_size) {
             SC_REPORT_FATAL("TLM-ROUTER", "Out of bound access to WBRAM");
         }
-        if (memory.find(address) != memory.end()) {
-            w = memory.at(address);
-        } else {
-            // uninitialized memory location, returning XXX;
-            for (int i=0; i < DWIDTH; i++)
-                w.set_bit(i, 'X');
-        }
-        return w;
+        if (!is_valid(address))
+            return undefined;
+        return sc_bv<DWIDTH>(memory[address]);
     }
 
+    /**
+     * Merges the bytes of `value` selected by `sel` into the word at `address`
+     * and returns the new word. Unselected bytes of a word never written keep
+     * the bits of the 'X' pattern.
+     */
     sc_bv<DWIDTH> set_word(uint32_t address, sc_bv<DWIDTH> value, sc_bv<DWIDTH/8> sel) {
-        sc_bv<DWIDTH> w;
         if (address > mem_size) {
             SC_REPORT_FATAL("TLM-ROUTER", "Out of bound access to WBRAM");
         }
-        w = retrieve_word(address);
-        for (int i=0; i<DWIDTH/8; i++) {
-            if (sel.get_bit(i) == 1) {
-                w.range((i+1)*8-1,i*8) = value.range((i+1)*8-1,i*8);
-            }
-        }
-        return w;
+        word_t mask = sel_mask[sel.to_uint() & ((1 << SEL_WIDTH) - 1)];
+        word_t& w = memory[address];
+        w = (w & ~mask) | (word_t(value.to_uint64()) & mask);
+        valid[address >> 6] |= uint64_t(1) << (address & 63);
+        return sc_bv<DWIDTH>(w);
     }
 
 
+    /**
+     * Selects Wishbone B4 pipelined cycles (true) or classic/registered
+     * feedback cycles (false, the default)
+     */
+    void setPipelined(bool pipelined) {
+        this->pipelined = pipelined;
+    }
+
+    /**
+     * Stalls one pipelined request out of `stall_period` clocks (0: never)
+     */
+    void setStallPeriod(unsigned int stall_period) {
+        this->stall_period = stall_period;
+        stall_count = 0;
+    }
+
+    void write_word(uint32_t address) {
+        word = set_word(address, dat_i.read(), sel_i.read());
+        db_wr_ops.write(db_wr_ops.read()+1);
+        if (verbose)
+            cout << "WBRAM: Wrote: 0x" << hex << word.to_int() << " @ "<< sc_time_stamp() << endl;
+    }
+
+    void read_word(uint32_t address) {
+        word = retrieve_word(address);
+        db_rd_ops.write(db_rd_ops.read()+1);
+        if (verbose)
+            cout << "WBRAM: Read: " << hex << word.to_int() << " @ " << sc_time_stamp() << endl;
+        dat_o.write(word);
+    }
+
     void handleop() {
         ack_o.write(false);
-        if (cyc_i.read() && stb_i.read()) {
-            if (!n_tran) {
-                int32_t address = adr_i.read().to_uint();
-                if (we_i.read()) {
-                    word = set_word(address, dat_i.read(), sel_i.read());
-                    cout << "WBRAM: Writing: 0x" << hex << word.to_int() << " @ "<< sc_time_stamp() << endl;
-                    db_wr_ops.write(db_wr_ops.read()+1);
-                    memory[address] = word;
-                    cout << "WBRAM: Wrote: 0x" << hex << memory[address] << " @ "<< sc_time_stamp() << endl;
-                } else {
-                    word = retrieve_word(address);
-                    cout << "WBRAM: Read: " << hex << word.to_int() << " @ " << sc_time_stamp() << endl;
-                    db_rd_ops.write(db_rd_ops.read()+1);
-                }
-                n_tran = true;
-                ack_o.write(true);
-                dat_o.write(word);
-            } else {
-                n_tran = false;
-            }
+        // Announced on the previous clock
+        bool stalled = false;
+        if (stall_o.size()) {
+            stalled = stall_o->read();
+            stall_o->write(pipelined && stall_period && (++stall_count % stall_period) == 0);
+        }
+        if (!(cyc_i.read() && stb_i.read())) {
+            n_tran = false;
+            write_pending = false;
+            return;
+        }
+        uint32_t address = adr_i.read().to_uint();
+        if (pipelined && stalled)
+            return;
+        if (pipelined || !n_tran) {
+            // New request
+            if (we_i.read())
+                write_word(address);
+            else
+                read_word(address);
+            burst_adr = address;
+            n_tran = true;
+            ack_o.write(true);
+            return;
+        }
+        // The strobe still shows the word acknowledged last clock
+        if (write_pending) {
+            write_word(address);
+            write_pending = false;
+        }
+        WB_CTI_t cti = cti_i.size() ? WB_CTI_t(cti_i->read().to_uint()) : WB_CTI_CLASSIC;
+        if (cti == WB_CTI_CONSTANT || cti == WB_CTI_INCREMENT) {
+            WB_BTE_t bte = bte_i.size() ? WB_BTE_t(bte_i->read().to_uint()) : WB_BTE_LINEAR;
+            if (cti == WB_CTI_INCREMENT)
+                burst_adr = wb_next_address(burst_adr, bte);
+            if (we_i.read())
+                write_pending = true;
+            else
+                read_word(burst_adr);
+            ack_o.write(true);
+        } else {
+            n_tran = false;
         }
     }
 
 
-    WBRAM(sc_module_name name, uint32_t mem_size=0x100)
-        : sc_module(name), mem_size(mem_size)
+    WBRAM(sc_module_name name, uint32_t mem_size=0x100, bool verbose=false)
+        : sc_module(name), undefined(undefined_word()), mem_size(mem_size), verbose(verbose)
     {
+        // Addresses up to mem_size included are accepted
+        uint64_t words = uint64_t(mem_size) + 1;
+        if (words > MAX_WORDS) {
+            std::stringstream err;
+            err << "WBRAM: mem_size 0x" << hex << mem_size << " exceeds the dense storage limit of 0x"
+                << MAX_WORDS - 1 << dec;
+            SC_REPORT_ERROR("WBRAM", err.str().c_str());
+            this->mem_size = MAX_WORDS - 1;
+            words = MAX_WORDS;
+        }
+        memory.assign(words, word_t(undefined.to_uint64()));
+        valid.assign((words + 63) / 64, 0);
+        for (int sel = 0; sel < (1 << SEL_WIDTH); sel++) {
+            sel_mask[sel] = 0;
+            for (int i = 0; i < SEL_WIDTH; i++) {
+                if (sel & (1 << i))
+                    sel_mask[sel] |= word_t(0xFF) << (i * 8);
+            }
+        }
         SC_METHOD(handleop);
         sensitive << clk_i.pos();
     }
@@ -115,5 +238,3 @@ struct WBRAM: sc_module
 using WBRAM32 = WBRAM<32>;
 
 #endif //__WBRAM_H__
-
-
@@ -0,0 +1,59 @@
+/**
+ * @file byte_enable.hpp
+ * @author Riverlane, 2020
+ *
+ */
+
+#ifndef __BYTE_ENABLE_H__
+#define __BYTE_ENABLE_H__
+
+#include <cstdint>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Copies the `len` bytes of `src` into `dst` whose byte enable is set
+ * (TLM_BYTE_ENABLED, 0xFF); the other bytes of `dst` are left untouched.
+ *
+ * Byte i uses enable be[(be_offset + i) % be_len], as the byte enable array
+ * of a TLM payload repeats when it is shorter than the data.
+ * When SSE2 is available 16 bytes are merged at a time with a compare and an
+ * and/andnot/or blend, provided the enables do not wrap inside the copy or
+ * their pattern divides 16.
+ */
+inline void masked_copy(unsigned char* dst, const unsigned char* src, unsigned int len,
+                        const unsigned char* be, unsigned int be_len, unsigned int be_offset = 0)
+{
+    unsigned int i = 0;
+#ifdef __SSE2__
+    const __m128i enabled = _mm_set1_epi8(static_cast<char>(0xFF));
+    if (be_offset + len <= be_len) {
+        for (; i + 16 <= len; i += 16) {
+            __m128i m = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(be + be_offset + i)), enabled);
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                             _mm_or_si128(_mm_and_si128(m, s), _mm_andnot_si128(m, d)));
+        }
+    } else if (len >= 16 && be_len <= 16 && 16 % be_len == 0) {
+        // Short repeating pattern: expanded once into a full vector
+        unsigned char pattern[16];
+        for (unsigned int k = 0; k < 16; k++)
+            pattern[k] = be[(be_offset + k) % be_len];
+        __m128i m = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern)), enabled);
+        for (; i + 16 <= len; i += 16) {
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                             _mm_or_si128(_mm_and_si128(m, s), _mm_andnot_si128(m, d)));
+        }
+    }
+#endif
+    for (; i < len; i++)
+        if (be[(be_offset + i) % be_len] == 0xFF)
+            dst[i] = src[i];
+}
+
+#endif //__BYTE_ENABLE_H__
@@ -7,11 +7,18 @@
 #define __INITIATOR_H__
 
 #include "tlm_utils/simple_initiator_socket.h"
+#include "tlm_utils/tlm_quantumkeeper.h"
 
 
 /**
  * Initiator implements simple read and write operations via
- * TLM mechanism
+ * TLM mechanism.
+ * The delay annotated by the targets is accumulated by a quantum keeper per
+ * thread and passed on to the targets as the local time of the initiator.
+ * The local time is kept across accesses and the thread only synchronises
+ * with the kernel once the global quantum is reached
+ * (tlm_quantumkeeper::set_global_quantum). `idle` is added to the local
+ * time after each access.
 */
 struct Initiator: sc_module
 {
@@ -21,10 +28,17 @@ struct Initiator: sc_module
     sc_signal<bool> re;
 
     uint64_t addr;
+    uint64_t len {4};
     uint64_t wid;
     unsigned char *ptr; 
     unsigned char *byt;
 
+    tlm_utils::tlm_quantumkeeper qk_write;
+    tlm_utils::tlm_quantumkeeper qk_read;
+    sc_time idle {SC_ZERO_TIME};
+    // Number of times either thread synchronised with the kernel
+    unsigned int syncs {0};
+
     SC_CTOR(Initiator) : socket("socket")
     {
         SC_THREAD(pwrite);
@@ -39,11 +53,12 @@ struct Initiator: sc_module
     {
         tlm::tlm_generic_payload trans;
         while(true) {
-            sc_time delay(0,SC_NS);
+            // Targets see the local time of the initiator
+            sc_time delay = qk_write.get_local_time();
             trans.set_command( tlm::TLM_WRITE_COMMAND );
             trans.set_address( addr );
             trans.set_data_ptr( ptr );
-            trans.set_data_length( 4 );
+            trans.set_data_length( len );
             trans.set_streaming_width( wid ); // = data_length to indicate no streaming
             trans.set_byte_enable_ptr( byt );
             trans.set_dmi_allowed( false ); // Mandatory initial value
@@ -53,6 +68,12 @@ struct Initiator: sc_module
             // Initiator obliged to check response status
             if (trans.is_response_error())
                 SC_REPORT_ERROR("TLM-2", trans.get_response_string().c_str());
+            qk_write.set( delay );
+            qk_write.inc( idle );
+            if (qk_write.need_sync()) {
+                qk_write.sync();
+                syncs++;
+            }
             wait();
         }
     }
@@ -61,11 +82,12 @@ struct Initiator: sc_module
     {
         tlm::tlm_generic_payload trans;
         while (true) {
-            sc_time delay(0,SC_NS);
+            // Targets see the local time of the initiator
+            sc_time delay = qk_read.get_local_time();
             trans.set_command( tlm::TLM_READ_COMMAND );
             trans.set_address( addr );
             trans.set_data_ptr( ptr );
-            trans.set_data_length( 4 );
+            trans.set_data_length( len );
             trans.set_streaming_width( wid ); // = data_length to indicate no streaming
             trans.set_byte_enable_ptr( 0 ); // 0 indicates unused
             trans.set_dmi_allowed( false ); // Mandatory initial value
@@ -75,6 +97,12 @@ struct Initiator: sc_module
             // Initiator obliged to check response status
             if (trans.is_response_error())
                 SC_REPORT_ERROR("TLM-2", trans.get_response_string().c_str());
+            qk_read.set( delay );
+            qk_read.inc( idle );
+            if (qk_read.need_sync()) {
+                qk_read.sync();
+                syncs++;
+            }
             wait();
         }
     }
@@ -84,6 +112,7 @@ inline void _initiator_dowrite(Initiator& init, uint32_t* data, uint32_t addr, u
     cout << "dowrite called" << " @ " << sc_time_stamp() << endl;
     init.addr = static_cast<uint64_t>(addr);
     init.ptr = reinterpret_cast<unsigned char*>(data);
+    init.len = len;
     init.wid = wid;
     init.byt = mask; 
     init.we.write(1);
@@ -99,6 +128,7 @@ inline void _initiator_dowrite(Initiator& init, uint32_t* data, uint32_t addr, u
 inline void _initiator_doread(Initiator& init, uint32_t* data, uint32_t addr, uint32_t len, uint32_t wid){
     cout << "doread called" << " @ " << sc_time_stamp() << endl;
     init.addr = static_cast<uint64_t>(addr);
+    init.len = len;
     init.wid = len;
     init.ptr = reinterpret_cast<unsigned char*> (data);
     init.re.write(1);
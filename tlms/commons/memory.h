@@ -1,6 +1,8 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+#include "tlms/commons/byte_enable.hpp"
+
 // *****************************************************************************************
 // Target memory implements b_transport, DMI and debug
 // *****************************************************************************************
@@ -24,36 +26,56 @@ struct Memory: sc_module
     socket.register_transport_dbg(     this, &Memory::transport_dbg);
   }
 
+  // Bursts of any length are supported: a contiguous transfer is a single memcpy.
+  // With a streaming width shorter than the data the same `wid` bytes are
+  // accessed repeatedly; byte enables are merged with masked_copy.
   virtual void b_transport( tlm::tlm_generic_payload& trans, sc_time& delay )
   {
     tlm::tlm_command cmd = trans.get_command();
-    sc_dt::uint64    adr = trans.get_address() / 4;
+    sc_dt::uint64    adr = trans.get_address();
     unsigned char*   ptr = trans.get_data_ptr();
     unsigned int     len = trans.get_data_length();
     unsigned char*   byt = trans.get_byte_enable_ptr();
     unsigned int     wid = trans.get_streaming_width();
 
-    if (adr > sc_dt::uint64(SIZE)) {
-      trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
+    if (wid == 0) {
+      trans.set_response_status( tlm::TLM_BURST_ERROR_RESPONSE );
       return;
     }
-    if (byt != 0) {
-      trans.set_response_status( tlm::TLM_BYTE_ENABLE_ERROR_RESPONSE );
+    if (wid > len)
+      wid = len;
+    if (adr >= sc_dt::uint64(SIZE) * 4 || wid > sc_dt::uint64(SIZE) * 4 - adr) {
+      trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
       return;
     }
-    if (len > 4 || wid < len) {
-      trans.set_response_status( tlm::TLM_BURST_ERROR_RESPONSE );
+    if (cmd == tlm::TLM_IGNORE_COMMAND) {
+      trans.set_response_status( tlm::TLM_OK_RESPONSE );
       return;
     }
 
-    if (trans.get_command() == tlm::TLM_READ_COMMAND){
-      memcpy(ptr, &mem[adr], len);
-      rd_ops.write(rd_ops+1);
+    unsigned char* cell = reinterpret_cast<unsigned char*>(mem) + adr;
+    unsigned int byt_len = trans.get_byte_enable_length();
+    if (byt && byt_len == 0)
+      byt_len = len;
+    for (unsigned int done = 0; done < len; done += wid) {
+      unsigned int beat = std::min(wid, len - done);
+      if (cmd == tlm::TLM_READ_COMMAND) {
+        if (byt)
+          masked_copy(ptr + done, cell, beat, byt, byt_len, done);
+        else
+          memcpy(ptr + done, cell, beat);
+      } else {
+        if (byt)
+          masked_copy(cell, ptr + done, beat, byt, byt_len, done);
+        else
+          memcpy(cell, ptr + done, beat);
+      }
     }
-    else if (cmd == tlm::TLM_WRITE_COMMAND){
-      memcpy(&mem[adr], ptr, len);
+
+    if (cmd == tlm::TLM_READ_COMMAND)
+      rd_ops.write(rd_ops+1);
+    else
       wr_ops.write(wr_ops+1);
-    }
 
     // Use temporal decoupling: add memory latency to delay argument
     delay += LATENCY;
@@ -85,17 +107,20 @@ struct Memory: sc_module
   virtual unsigned int transport_dbg(tlm::tlm_generic_payload& trans)
   {
     tlm::tlm_command cmd = trans.get_command();
-    sc_dt::uint64    adr = trans.get_address() / 4;
+    sc_dt::uint64    adr = trans.get_address();
     unsigned char*   ptr = trans.get_data_ptr();
     unsigned int     len = trans.get_data_length();
 
+    if (adr >= sc_dt::uint64(SIZE) * 4)
+      return 0;
     // Calculate the number of bytes to be actually copied
-    unsigned int num_bytes = (len < (SIZE - adr) * 4) ? len : (SIZE - adr) * 4;
+    unsigned int num_bytes = std::min<sc_dt::uint64>(len, sc_dt::uint64(SIZE) * 4 - adr);
 
+    unsigned char* cell = reinterpret_cast<unsigned char*>(mem) + adr;
     if ( cmd == tlm::TLM_READ_COMMAND )
-      memcpy(ptr, &mem[adr], num_bytes);
+      memcpy(ptr, cell, num_bytes);
     else if ( cmd == tlm::TLM_WRITE_COMMAND )
-      memcpy(&mem[adr], ptr, num_bytes);
+      memcpy(cell, ptr, num_bytes);
 
     return num_bytes;
   }
@@ -0,0 +1,125 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <systemc>
+#include <tlm.h>
+#include "tlm_utils/simple_initiator_socket.h"
+#include "tlm_utils/simple_target_socket.h"
+#include "commons/assertions.hpp"
+#include "tlms/commons/memory.h"
+
+using namespace std;
+
+typedef Memory<0x100> Mem;
+
+tlm::tlm_response_status access(Mem& mem, tlm::tlm_command cmd, uint64_t address,
+                                unsigned char* data, unsigned int len, unsigned int wid,
+                                unsigned char* byt = nullptr, unsigned int byt_len = 0){
+    tlm::tlm_generic_payload trans;
+    sc_time delay = SC_ZERO_TIME;
+    trans.set_command(cmd);
+    trans.set_address(address);
+    trans.set_data_ptr(data);
+    trans.set_data_length(len);
+    trans.set_streaming_width(wid);
+    trans.set_byte_enable_ptr(byt);
+    trans.set_byte_enable_length(byt_len);
+    trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+    mem.b_transport(trans, delay);
+    return trans.get_response_status();
+}
+
+void test_cache_line(Mem& mem){
+    vector<unsigned char> line(64), back(64, 0);
+    for (unsigned int i = 0; i < line.size(); i++)
+        line[i] = i * 3;
+    checkValuesMatch<int>(tlm::TLM_OK_RESPONSE, access(mem, tlm::TLM_WRITE_COMMAND, 0x40, line.data(), 64, 64), "burst-write");
+    checkValuesMatch<int>(tlm::TLM_OK_RESPONSE, access(mem, tlm::TLM_READ_COMMAND, 0x40, back.data(), 64, 64), "burst-read");
+    checkValuesMatch<unsigned char>(line, back, "burst-data");
+    checkValuesMatch<uint32_t>(0x15120F0C, mem.mem[0x44/4], "burst-word");
+}
+
+void test_streaming(Mem& mem){
+    // Writing 4 beats to a 4-byte wide FIFO-like location: the last beat stays
+    vector<unsigned char> data(16);
+    for (unsigned int i = 0; i < data.size(); i++)
+        data[i] = 0x10 + i;
+    access(mem, tlm::TLM_WRITE_COMMAND, 0x100, data.data(), 16, 4);
+    checkValuesMatch<uint32_t>(0x1F1E1D1C, mem.mem[0x100/4], "stream-write");
+    checkValuesMatch<uint32_t>(0, mem.mem[0x104/4], "stream-write-bounds");
+
+    // Reading repeats the same 4 bytes
+    vector<unsigned char> back(16, 0);
+    access(mem, tlm::TLM_READ_COMMAND, 0x100, back.data(), 16, 4);
+    for (unsigned int i = 0; i < back.size(); i++)
+        checkValuesMatch<unsigned int>(0x1C + (i % 4), back[i], "stream-read");
+}
+
+void test_byte_enables(Mem& mem){
+    vector<unsigned char> data(32, 0xAA);
+    access(mem, tlm::TLM_WRITE_COMMAND, 0x200, data.data(), 32, 32);
+
+    // Full-length enables
+    vector<unsigned char> byt(32);
+    for (unsigned int i = 0; i < byt.size(); i++)
+        byt[i] = (i % 3) ? tlm::TLM_BYTE_ENABLED : tlm::TLM_BYTE_DISABLED;
+    vector<unsigned char> ones(32, 0x55);
+    access(mem, tlm::TLM_WRITE_COMMAND, 0x200, ones.data(), 32, 32, byt.data(), 32);
+    vector<unsigned char> back(32, 0);
+    access(mem, tlm::TLM_READ_COMMAND, 0x200, back.data(), 32, 32);
+    for (unsigned int i = 0; i < back.size(); i++)
+        checkValuesMatch<unsigned int>((i % 3) ? 0x55 : 0xAA, back[i], "be-full");
+
+    // Repeating 4-byte pattern over a 32-byte write
+    unsigned char pattern[4] = {tlm::TLM_BYTE_ENABLED, tlm::TLM_BYTE_DISABLED, tlm::TLM_BYTE_DISABLED, tlm::TLM_BYTE_ENABLED};
+    vector<unsigned char> zeros(32, 0);
+    access(mem, tlm::TLM_WRITE_COMMAND, 0x200, zeros.data(), 32, 32, pattern, 4);
+    access(mem, tlm::TLM_READ_COMMAND, 0x200, back.data(), 32, 32);
+    for (unsigned int i = 0; i < back.size(); i++) {
+        unsigned int before = (i % 3) ? 0x55 : 0xAA;
+        checkValuesMatch<unsigned int>((i % 4 == 0 || i % 4 == 3) ? 0 : before, back[i], "be-pattern");
+    }
+}
+
+void test_masked_copy(){
+    // SIMD paths against a byte by byte reference
+    mt19937 rng(0xB17E);
+    for (unsigned int round = 0; round < 1000; round++) {
+        unsigned int len = 1 + rng() % 100;
+        unsigned int be_len = 1 + rng() % 40;
+        unsigned int be_offset = rng() % be_len;
+        vector<unsigned char> src(len), dst(len), ref(len), be(be_len);
+        for (auto& b : src) b = rng();
+        for (auto& b : dst) b = rng();
+        for (auto& b : be) b = (rng() % 2) ? 0xFF : 0x00;
+        for (unsigned int i = 0; i < len; i++)
+            ref[i] = (be[(be_offset + i) % be_len] == 0xFF) ? src[i] : dst[i];
+        masked_copy(dst.data(), src.data(), len, be.data(), be_len, be_offset);
+        checkValuesMatch<unsigned char>(ref, dst, "masked-copy");
+    }
+}
+
+void test_response_rules(Mem& mem){
+    uint32_t value = 0;
+    unsigned char* ptr = reinterpret_cast<unsigned char*>(&value);
+    checkValuesMatch<int>(tlm::TLM_ADDRESS_ERROR_RESPONSE, access(mem, tlm::TLM_READ_COMMAND, 0x400, ptr, 4, 4), "rule-address");
+    checkValuesMatch<int>(tlm::TLM_ADDRESS_ERROR_RESPONSE, access(mem, tlm::TLM_READ_COMMAND, 0x3FE, ptr, 4, 4), "rule-address-end");
+    checkValuesMatch<int>(tlm::TLM_BURST_ERROR_RESPONSE, access(mem, tlm::TLM_READ_COMMAND, 0x0, ptr, 4, 0), "rule-width");
+    checkValuesMatch<int>(tlm::TLM_OK_RESPONSE, access(mem, tlm::TLM_IGNORE_COMMAND, 0x0, ptr, 4, 4), "rule-ignore");
+}
+
+int sc_main(int argc, char** argv) {
+
+    Mem mem = Mem("memory");
+
+    try {
+        test_cache_line(mem);
+        test_streaming(mem);
+        test_byte_enables(mem);
+        test_masked_copy();
+        test_response_rules(mem);
+    } catch (const std::exception& ex) {
+        SC_REPORT_ERROR("TEST_FAILURE", ex.what());
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <systemc>
+#include <tlm.h>
+#include "tlm_utils/tlm_quantumkeeper.h"
+#include "tlms/tlm_router/tlm_router.hpp"
+#include "tlms/tlm_memories/tlm_rom.hpp"
+#include "tlms/commons/memory.h"
+#include "commons/assertions.hpp"
+
+using namespace std;
+
+const sc_time ROM_LATENCY(5, SC_NS);
+
+/**
+ * Loosely-timed initiator running back-to-back reads with a quantum keeper.
+ * It counts the number of times it hands control back to the kernel.
+ */
+struct LTInitiator: sc_module
+{
+    tlm_utils::simple_initiator_socket<LTInitiator> socket;
+    tlm_utils::tlm_quantumkeeper qk;
+
+    uint64_t address {0};
+    unsigned int naccesses {0};
+    unsigned int syncs {0};
+    sc_time begin;
+    sc_time finish;
+    sc_event start;
+
+    void run() {
+        tlm::tlm_generic_payload trans;
+        uint32_t data;
+        while (true) {
+            wait(start);
+            begin = sc_time_stamp();
+            qk.reset();
+            syncs = 0;
+            for (unsigned int i = 0; i < naccesses; i++) {
+                sc_time delay = qk.get_local_time();
+                trans.set_command( tlm::TLM_READ_COMMAND );
+                trans.set_address( address + (i % 8) * 4 );
+                trans.set_data_ptr( reinterpret_cast<unsigned char*>(&data) );
+                trans.set_data_length( 4 );
+                trans.set_streaming_width( 4 );
+                trans.set_byte_enable_ptr( 0 );
+                trans.set_response_status( tlm::TLM_INCOMPLETE_RESPONSE );
+                socket->b_transport( trans, delay );
+                if (trans.is_response_error())
+                    SC_REPORT_ERROR("TLM-2", trans.get_response_string().c_str());
+                qk.set( delay );
+                if (qk.need_sync()) {
+                    qk.sync();
+                    syncs++;
+                }
+            }
+            qk.sync();
+            finish = sc_time_stamp();
+        }
+    }
+
+    SC_CTOR(LTInitiator) : socket("socket")
+    {
+        SC_THREAD(run);
+    }
+};
+
+// Runs `naccesses` reads at `address` and returns the simulated time they took
+sc_time run_accesses(LTInitiator& init, uint64_t address, unsigned int naccesses){
+    init.address = address;
+    init.naccesses = naccesses;
+    init.start.notify(SC_ZERO_TIME);
+    sc_start(1, SC_MS);
+    return init.finish - init.begin;
+}
+
+void test_quantum_sync(LTInitiator& init, unsigned int naccesses){
+    // No quantum: every annotated delay is waited for
+    tlm_utils::tlm_quantumkeeper::set_global_quantum(SC_ZERO_TIME);
+    run_accesses(init, 0x0, naccesses);
+    checkValuesMatch<unsigned int>(naccesses, init.syncs, "quantum-zero-syncs");
+
+    // 1 us quantum, Memory annotates 10 ns per access: one sync every 100 accesses
+    tlm_utils::tlm_quantumkeeper::set_global_quantum(sc_time(1, SC_US));
+    run_accesses(init, 0x0, naccesses);
+    checkValuesMatch<unsigned int>(naccesses / 100, init.syncs, "quantum-1us-syncs");
+}
+
+void test_annotated_time(LTInitiator& init, unsigned int naccesses){
+    // Whatever the quantum, the time taken adds up to the latencies of the targets
+    tlm_utils::tlm_quantumkeeper::set_global_quantum(sc_time(100, SC_US));
+    sc_time elapsed = run_accesses(init, 0x0, naccesses);
+    checkValuesMatch<double>((sc_time(10, SC_NS) * naccesses).to_seconds(), elapsed.to_seconds(),
+                             "annotated-memory");
+    elapsed = run_accesses(init, 0x1000, naccesses);
+    checkValuesMatch<double>((ROM_LATENCY * naccesses).to_seconds(), elapsed.to_seconds(),
+                             "annotated-rom");
+}
+
+int sc_main(int argc, char** argv) {
+
+    LTInitiator init("init");
+    Memory<0x100> mem = Memory<0x100>("memory");
+    TLM_ROM rom("rom", 0, "/workdir/models/memories/tests/image_for_storage.img", ROM_LATENCY);
+    TLMRouter<1, 2> router = TLMRouter<1, 2>("router", "/workdir/build/tlm_quantum.csv");
+
+    init.socket.bind(*(router.target_socket[0]));
+    router.initiator_socket[0]->bind(mem.socket);
+    router.initiator_socket[1]->bind(rom.dataBus);
+    router.setInitiatorProperties(0, {0x0, 0x1000, 0xFFF});
+    router.setInitiatorProperties(1, {0x1000, 0x1040, 0x3F});
+
+    // Tracing every access would dominate the run time
+    router.trace_filter.set_enabled(false);
+
+    const unsigned int NACCESSES = 1000;
+
+    try {
+        test_quantum_sync(init, NACCESSES);
+        test_annotated_time(init, NACCESSES);
+    } catch (const std::exception& ex) {
+        SC_REPORT_ERROR("TEST_FAILURE", ex.what());
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file wishbone_burst.hpp
+ * @author Riverlane, 2020
+ *
+ */
+
+#ifndef __WISHBONE_BURST_H__
+#define __WISHBONE_BURST_H__
+
+#include <cstdint>
+
+/**
+ * Cycle Type Identifier (CTI_O/CTI_I), Wishbone B4 section 4.3
+ */
+enum WB_CTI_t {
+    WB_CTI_CLASSIC = 0,
+    WB_CTI_CONSTANT = 1,
+    WB_CTI_INCREMENT = 2,
+    WB_CTI_END = 7
+};
+
+/**
+ * Burst Type Extension (BTE_O/BTE_I), Wishbone B4 section 4.4
+ */
+enum WB_BTE_t {
+    WB_BTE_LINEAR = 0,
+    WB_BTE_WRAP4 = 1,
+    WB_BTE_WRAP8 = 2,
+    WB_BTE_WRAP16 = 3
+};
+
+/**
+ * Number of beats after which a burst of type `bte` wraps (0 when linear)
+ */
+inline unsigned int wb_wrap_beats(WB_BTE_t bte) {
+    return bte == WB_BTE_LINEAR ? 0 : 2u << bte;
+}
+
+/**
+ * Word address following `adr` in an incrementing burst of type `bte`
+ */
+inline uint64_t wb_next_address(uint64_t adr, WB_BTE_t bte) {
+    uint64_t wrap = wb_wrap_beats(bte);
+    if (!wrap)
+        return adr + 1;
+    return (adr & ~(wrap - 1)) | ((adr + 1) & (wrap - 1));
+}
+
+#endif //__WISHBONE_BURST_H__
@@ -60,6 +60,149 @@ void test_byte_enable(Initiator& init) {
     checkValuesMatch<uint32_t>(data, 0xBA0000FE, "check_@20");
 }
 
+void test_wbram_storage(WBRAM32& ram) {
+    // Byte lanes 0 and 2 of a word never written: the other lanes keep the 'X' pattern
+    checkValuesMatch<bool>(ram.is_valid(0x80), false, "check_unwritten");
+    uint32_t undefined = ram.undefined.to_uint();
+    ram.set_word(0x80, sc_bv<32>(0x11223344), sc_bv<4>(0x5));
+    checkValuesMatch<bool>(ram.is_valid(0x80), true, "check_written");
+    checkValuesMatch<uint32_t>(ram.retrieve_word(0x80).to_uint(),
+                               (undefined & 0xFF00FF00) | 0x00220044, "check_sel_merge");
+}
+
+// The helpers run 21 clocks per access: the 16 words only complete in time
+// at one word per clock
+void test_burst_writes_reads(Initiator& init) {
+    uint32_t data [16];
+    for (int i=0; i<16; i++) {
+        data[i] = 0x10000000 + i;
+    }
+    _initiator_dowrite(init, data, 0x40, 64);
+    for (int i=0; i<16; i++) {
+        data[i] = 0;
+    }
+    _initiator_doread(init, data, 0x40, 64);
+    for (int i=0; i<16; i++) {
+        checkValuesMatch<uint32_t>(data[i], 0x10000000 + i, "check_burst");
+    }
+}
+
+void test_pipelined_writes_reads(Initiator& init, TLM2WB_32& bridge, WBRAM32& ram) {
+    uint32_t data [16];
+    bridge.setPipelined(true);
+    ram.setPipelined(true);
+    for (int i=0; i<16; i++) {
+        data[i] = 0x20000000 + i;
+    }
+    _initiator_dowrite(init, data, 0x80, 64);
+    for (int i=0; i<16; i++) {
+        data[i] = 0;
+    }
+    _initiator_doread(init, data, 0x80, 64);
+    for (int i=0; i<16; i++) {
+        checkValuesMatch<uint32_t>(data[i], 0x20000000 + i, "check_pipelined");
+    }
+    bridge.setPipelined(false);
+    ram.setPipelined(false);
+}
+
+void test_pipelined_stall(Initiator& init, TLM2WB_32& bridge, WBRAM32& ram) {
+    // The memory is busy one clock out of three: every strobe is taken once
+    uint32_t data [8];
+    bridge.setPipelined(true);
+    ram.setPipelined(true);
+    ram.setStallPeriod(3);
+    long int wr_ops = ram.db_wr_ops.read();
+    long int rd_ops = ram.db_rd_ops.read();
+    for (int i=0; i<8; i++) {
+        data[i] = 0x50000000 + i;
+    }
+    _initiator_dowrite(init, data, 0x180, 32);
+    for (int i=0; i<8; i++) {
+        data[i] = 0;
+    }
+    _initiator_doread(init, data, 0x180, 32);
+    for (int i=0; i<8; i++) {
+        checkValuesMatch<uint32_t>(data[i], 0x50000000 + i, "check_stall");
+    }
+    checkValuesMatch<long int>(ram.db_wr_ops.read() - wr_ops, 8, "check_stall_writes");
+    checkValuesMatch<long int>(ram.db_rd_ops.read() - rd_ops, 8, "check_stall_reads");
+    ram.setStallPeriod(0);
+    bridge.setPipelined(false);
+    ram.setPipelined(false);
+}
+
+void test_wrap_burst(Initiator& init, TLM2WB_32& bridge) {
+    uint32_t data [5] = {0x30000000, 0x30000001, 0x30000002, 0x30000003, 0x30000004};
+    _initiator_dowrite(init, data, 0xC0, 20);
+    bridge.setBurstType(WB_BTE_WRAP4);
+    // A whole aligned block is a wrapping burst
+    for (int i=0; i<5; i++) {
+        data[i] = 0;
+    }
+    _initiator_doread(init, data, 0xC0, 16);
+    for (int i=0; i<4; i++) {
+        checkValuesMatch<uint32_t>(data[i], 0x30000000 + i, "check_wrap");
+    }
+    // Unaligned: a linear burst, still covering [0xC4, 0xD4)
+    _initiator_doread(init, data, 0xC4, 16);
+    bridge.setBurstType(WB_BTE_LINEAR);
+    for (int i=0; i<4; i++) {
+        checkValuesMatch<uint32_t>(data[i], 0x30000001 + i, "check_wrap_unaligned");
+    }
+}
+
+void test_quantum(Initiator& init) {
+    const sc_time QUANTUM(1, SC_US);
+    tlm_utils::tlm_quantumkeeper::set_global_quantum(QUANTUM);
+    // Start on a quantum boundary
+    sc_start(tlm::tlm_global_quantum::instance().compute_local_quantum());
+
+    // Both threads sync once to pick up the new quantum
+    uint32_t data [4] = {0x40000000, 0x40000001, 0x40000002, 0x40000003};
+    _initiator_dowrite(init, data, 0x100, 16);
+    _initiator_doread(init, data, 0x100, 16);
+    unsigned int syncs = init.syncs;
+
+    // Each access takes 21 ns: they all run within the quantum without a sync
+    for (int n=0; n<4; n++) {
+        _initiator_dowrite(init, data, 0x100, 16);
+        for (int i=0; i<4; i++) {
+            data[i] = 0;
+        }
+        _initiator_doread(init, data, 0x100, 16);
+        for (int i=0; i<4; i++) {
+            checkValuesMatch<uint32_t>(data[i], 0x40000000 + i, "check_quantum");
+        }
+        checkValuesMatch<unsigned int>(syncs, init.syncs, "check_quantum_no_sync");
+    }
+
+    // Crossing the quantum: the next access syncs
+    sc_start(tlm::tlm_global_quantum::instance().compute_local_quantum());
+    _initiator_dowrite(init, data, 0x100, 16);
+    checkValuesMatch<unsigned int>(syncs + 1, init.syncs, "check_quantum_write_sync");
+    _initiator_doread(init, data, 0x100, 16);
+    checkValuesMatch<unsigned int>(syncs + 2, init.syncs, "check_quantum_read_sync");
+    tlm_utils::tlm_quantumkeeper::set_global_quantum(SC_ZERO_TIME);
+}
+
+
+void test_partial_words(TLM2WB_32& bridge) {
+    // Rejected before the bus is driven: the bridge can be called directly
+    uint8_t data [8] = {0};
+    for (unsigned int len : {0u, 1u, 2u, 6u}) {
+        tlm::tlm_generic_payload trans;
+        sc_time delay = SC_ZERO_TIME;
+        trans.set_command( tlm::TLM_READ_COMMAND );
+        trans.set_address( 0x0 );
+        trans.set_data_ptr( data );
+        trans.set_data_length( len );
+        trans.set_streaming_width( len );
+        trans.set_response_status( tlm::TLM_INCOMPLETE_RESPONSE );
+        bridge.b_transport(trans, delay);
+        checkValuesMatch<int>(tlm::TLM_BURST_ERROR_RESPONSE, trans.get_response_status(), "check_partial_word");
+    }
+}
 
 void test_timeout(Initiator& init, TLM2WB_32& bridge) {
     uint32_t data = 0xBABECAFE;
@@ -91,6 +234,9 @@ int sc_main(int argc, char** argv) {
     sc_signal<bool> m2s_cyc_o;
     sc_signal<sc_bv<32>> m2s_dat_i;
     sc_signal<bool> m2s_ack_i;
+    sc_signal<sc_bv<3>> m2s_cti_o;
+    sc_signal<sc_bv<2>> m2s_bte_o;
+    sc_signal<bool> m2s_stall_i;
 
     sc_trace(Tf, m2s_adr_o, "m2s_adr_o");
     sc_trace(Tf, m2s_dat_o, "m2s_dat_o");
@@ -100,6 +246,9 @@ int sc_main(int argc, char** argv) {
     sc_trace(Tf, m2s_cyc_o, "m2s_cyc_o");
     sc_trace(Tf, m2s_dat_i, "m2s_dat_i");
     sc_trace(Tf, m2s_ack_i, "m2s_ack_i");
+    sc_trace(Tf, m2s_cti_o, "m2s_cti_o");
+    sc_trace(Tf, m2s_bte_o, "m2s_bte_o");
+    sc_trace(Tf, m2s_stall_i, "m2s_stall_i");
 
     Initiator init1 = Initiator("tlm_init");
 
@@ -119,6 +268,9 @@ int sc_main(int argc, char** argv) {
     bridge.stb_o(m2s_stb_o);
     bridge.ack_i(m2s_ack_i);
     bridge.dat_i(m2s_dat_i);
+    bridge.cti_o(m2s_cti_o);
+    bridge.bte_o(m2s_bte_o);
+    bridge.stall_i(m2s_stall_i);
 
     ram.clk_i(clk);
     ram.rst_i(rst);
@@ -130,12 +282,22 @@ int sc_main(int argc, char** argv) {
     ram.stb_i(m2s_stb_o);
     ram.ack_o(m2s_ack_i);
     ram.dat_o(m2s_dat_i);
+    ram.cti_i(m2s_cti_o);
+    ram.bte_i(m2s_bte_o);
+    ram.stall_o(m2s_stall_i);
 
     try {
         test_standard_writes_reads(init1);
         test_streaming_writes_reads(init1);
         test_irregular_writes_reads(init1);
         test_byte_enable(init1);
+        test_wbram_storage(ram);
+        test_burst_writes_reads(init1);
+        test_pipelined_writes_reads(init1, bridge, ram);
+        test_pipelined_stall(init1, bridge, ram);
+        test_wrap_burst(init1, bridge);
+        test_quantum(init1);
+        test_partial_words(bridge);
         test_timeout(init1, bridge);
     } catch (const std::exception& ex) {
         sc_close_vcd_trace_file(Tf);
@@ -14,6 +14,7 @@ using namespace std;
 
 #include "tlm.h"
 #include "tlm_utils/simple_target_socket.h"
+#include "tlms/commons/wishbone_burst.hpp"
 
 
 /**
@@ -22,6 +23,23 @@ using namespace std;
  * the clocked logic (Wishbone) and the transaction layer.
  * NOTE: we currently support only 32 bits operations with byte granularity
  * Refer to rules RULE 3.95, RULE: 3.96 on Wishbone B4 specifications for more information
+ *
+ * A transaction of several words is a single bus cycle, and b_transport
+ * wakes up once, when the last word is acknowledged:
+ * - in classic mode the words are a registered feedback burst: cti_o tells
+ *   the slave the next address (incrementing, or constant when streaming),
+ *   so a slave supporting it acknowledges one word per clock;
+ * - in pipelined mode (setPipelined) a new strobe is issued on every clock
+ *   stall_i is low, with any number of strobes waiting for their ack.
+ *   Like ack_i, stall_i is registered: a slave raising it refuses the
+ *   request it sees on the next clock, and the bridge holds that request.
+ * With setBurstType(WRAP4/8/16) a transaction covering exactly one aligned
+ * block of that many words (e.g. a cache line fill) is signalled as a
+ * wrapping burst on bte_o; other transactions stay linear, so the words
+ * transferred are always [address, address + len).
+ * The data length must be a non-zero multiple of the bus width, otherwise
+ * the transaction ends with TLM_BURST_ERROR_RESPONSE.
+ * stall_i, cti_o and bte_o may be left unbound.
  */
 template <int AWIDTH=32, typename T=bool>
 struct TLM2WB: sc_module
@@ -43,6 +61,9 @@ struct TLM2WB: sc_module
     sc_out<T> cyc_o;
     sc_in<T> ack_i;
     sc_in<sc_bv<32>> dat_i;
+    sc_port<sc_signal_in_if<T>, 1, SC_ZERO_OR_MORE_BOUND> stall_i;
+    sc_port<sc_signal_inout_if<sc_bv<3>>, 1, SC_ZERO_OR_MORE_BOUND> cti_o;
+    sc_port<sc_signal_inout_if<sc_bv<2>>, 1, SC_ZERO_OR_MORE_BOUND> bte_o;
     //sc_out<bool> tagn_o;
 
     sc_bv<DWIDTH> bv_data;
@@ -53,11 +74,22 @@ struct TLM2WB: sc_module
     unsigned char*   ptr;
     unsigned int     len;
     unsigned char*   byt;
+    unsigned int     byt_len;
     unsigned int     wid;
     unsigned char    byteen;
     bool             pending_trans = false;
     unsigned char data [DWIDTH_BYTES];
 
+    // Words of the transaction: issued on the bus, and acknowledged
+    unsigned int words {0};
+    unsigned int issued {0};
+    unsigned int acked {0};
+    // Strobe asserted for words[issued - 1]
+    bool strobing {false};
+    WB_CTI_t cti {WB_CTI_CLASSIC};
+    // BTE of the current transaction
+    WB_BTE_t bte {WB_BTE_LINEAR};
+
     // State machine to handle the logic
     enum WB_state_t {IDLE, EXECUTING_WRITE, EXECUTING_READ, WAITING_FOR_ACK};
     WB_state_t state = {IDLE};
@@ -69,63 +101,148 @@ struct TLM2WB: sc_module
     unsigned int timeout = 1000;
     unsigned int elapsed {0};
 
+    bool pipelined {false};
+    WB_BTE_t burst_type {WB_BTE_LINEAR};
+
     void setTimeout(unsigned int timeout) {
         this->timeout = timeout;
     }
 
-    void wishbone_handler() {
-        switch (state) {
-        case IDLE:
-            break;
-        case EXECUTING_WRITE:
-            stb_o.write(true);
-            cyc_o.write(true);
-            we_o.write(true);
-            adr_o.write(adr);
-            byteen = 0;
+    /**
+     * Selects Wishbone B4 pipelined cycles (true) or classic/registered
+     * feedback cycles (false, the default)
+     */
+    void setPipelined(bool pipelined) {
+        this->pipelined = pipelined;
+    }
+
+    void setBurstType(WB_BTE_t burst_type) {
+        this->burst_type = burst_type;
+    }
+
+    /**
+     * Word address of beat `i` and offset of its data in the payload
+     */
+    void beat(unsigned int i, sc_dt::uint64& address, unsigned int& offset) const {
+        // Streaming: the address restarts every `wid` bytes
+        address = adr + ((i * DWIDTH_BYTES) % wid) / DWIDTH_BYTES;
+        offset = i * DWIDTH_BYTES;
+    }
+
+    // Cycle type of beat i, from the address of the next one
+    WB_CTI_t beat_cti(unsigned int i) const {
+        if (i + 1 < words) {
+            sc_dt::uint64 address, next;
+            unsigned int offset;
+            beat(i, address, offset);
+            beat(i + 1, next, offset);
+            if (next == address)
+                return WB_CTI_CONSTANT;
+            if (next == wb_next_address(address, bte))
+                return WB_CTI_INCREMENT;
+        }
+        return (cti == WB_CTI_CONSTANT || cti == WB_CTI_INCREMENT) ? WB_CTI_END : WB_CTI_CLASSIC;
+    }
+
+    void present(unsigned int n) {
+        sc_dt::uint64 address;
+        unsigned int offset;
+        beat(n, address, offset);
+        cti = beat_cti(n);
+        stb_o.write(true);
+        cyc_o.write(true);
+        we_o.write(wnr);
+        adr_o.write(address);
+        if (cti_o.size())
+            cti_o->write(cti);
+        if (bte_o.size())
+            bte_o->write(bte);
+        if (wnr) {
             for (int i=0; i < DWIDTH_BYTES; i++) {
-                bv_data.range((i+1)*8-1, i*8) = (ptr[DWIDTH_BYTES-i-1]);
+                bv_data.range((i+1)*8-1, i*8) = (ptr[offset+DWIDTH_BYTES-i-1]);
                 if (byt)
-                    bv_byteen.set_bit(i, byt[DWIDTH_BYTES-i-1] == 0xff);
+                    bv_byteen.set_bit(i, byt[(offset+DWIDTH_BYTES-i-1) % byt_len] == 0xff);
                 else
                     bv_byteen.set_bit(i, 1);
             }
             dat_o = bv_data;
-            wnr = true;
             sel_o.write(bv_byteen);
-            state = WAITING_FOR_ACK;
-            elapsed = 0; 
+        } else {
+            sel_o = 0;
+        }
+        strobing = true;
+    }
+
+    // Stores the read data of beat n
+    void complete(unsigned int n) {
+        if (wnr)
+            return;
+        sc_dt::uint64 address;
+        unsigned int offset;
+        beat(n, address, offset);
+        bv_data = dat_i;
+        for (int i=0; i < DWIDTH_BYTES; i++) {
+            ptr[offset+DWIDTH_BYTES-i-1] = (unsigned char)((bv_data.to_uint() >> i*8) & 0xFF);
+        }
+    }
+
+    void release_bus() {
+        stb_o.write(false);
+        cyc_o.write(false);
+        we_o.write(false);
+        sel_o = 0;
+        if (cti_o.size())
+            cti_o->write(WB_CTI_CLASSIC);
+        strobing = false;
+    }
+
+    void wishbone_handler() {
+        switch (state) {
+        case IDLE:
             break;
+        case EXECUTING_WRITE:
         case EXECUTING_READ:
-            stb_o.write(true);
-            cyc_o.write(true);
-            we_o.write(false);
-            adr_o.write(adr);
-            sel_o = 0;
-            wnr = false;
+            wnr = (state == EXECUTING_WRITE);
+            cti = WB_CTI_CLASSIC;
+            issued = acked = 0;
+            present(issued++);
             state = WAITING_FOR_ACK;
-            elapsed = 0; 
+            elapsed = 0;
             break;
-        case WAITING_FOR_ACK:
+        case WAITING_FOR_ACK: {
+            // The strobe of the last clock was taken unless the slave stalled
+            bool accepted = strobing && !(pipelined && stall_i.size() && stall_i->read());
             if (ack_i.read() != 0) {
-                stb_o.write(false);
-                cyc_o.write(false);
-                we_o.write(false);
-                sel_o = 0;
-                if (!wnr) {
-                    bv_data = dat_i;
-                    for (int i=0; i < DWIDTH_BYTES; i++) {
-                        ptr[DWIDTH_BYTES-i-1] = (unsigned char)((bv_data.to_uint() >> i*8) & 0xFF);
-                    }
+                complete(acked++);
+                elapsed = 0;
+                if (!pipelined) {
+                    // Classic: the next word goes out once the current one is acknowledged
+                    if (issued < words)
+                        present(issued++);
+                    else
+                        strobing = false;
                 }
+            }
+            if (pipelined && accepted) {
+                if (issued < words) {
+                    present(issued++);
+                } else {
+                    stb_o.write(false);
+                    strobing = false;
+                }
+            }
+            if (acked == words) {
+                release_bus();
                 state = IDLE;
                 ack_event.notify();
+                break;
             }
             if ((++elapsed) >= timeout) {
                 SC_REPORT_ERROR("TLM2WB", "Acknowledge not received");
             }
             break;
         }
+        }
     }
 
     // TLM-2 blocking transport method
@@ -134,30 +251,40 @@ struct TLM2WB: sc_module
         tlm::tlm_command cmd = trans.get_command();
         if ((cmd != tlm::tlm_command::TLM_WRITE_COMMAND) && (cmd != tlm::tlm_command::TLM_READ_COMMAND))
             SC_REPORT_ERROR("TLM-2", "Received an unsupported cmd");
-        WB_state_t _state;
-        _state = (trans.get_command() == tlm::tlm_command::TLM_WRITE_COMMAND) ? EXECUTING_WRITE : EXECUTING_READ;
-        state = _state;
+        // Only whole bus words are transferred
+        if (trans.get_data_length() == 0 || trans.get_data_length() % DWIDTH_BYTES != 0) {
+            trans.set_response_status( tlm::TLM_BURST_ERROR_RESPONSE );
+            return;
+        }
+        // The bus is driven in simulated time: the initiator's local time is consumed first
+        if (delay != SC_ZERO_TIME) {
+            wait(delay);
+            delay = SC_ZERO_TIME;
+        }
         adr = trans.get_address() >> BYTE_ADDRESSING;
         ptr = trans.get_data_ptr();
         len = trans.get_data_length();
         byt = trans.get_byte_enable_ptr();
+        byt_len = trans.get_byte_enable_length();
         wid = trans.get_streaming_width();
 
         if (wid == 0) {
             SC_REPORT_WARNING("TLM_WB2TLM", "TLM LRM: A streaming width of 0 shall be invalid. Making wid=len and proceeding.");
             wid = len;
         }
+        if (wid > len)
+            wid = len;
+        if (byt && byt_len == 0)
+            byt_len = len;
+        words = len / DWIDTH_BYTES;
+        wid = std::max<unsigned int>(wid - wid % DWIDTH_BYTES, DWIDTH_BYTES);
+        // Wrapping bursts only for whole aligned blocks: the burst never wraps
+        // and covers exactly the payload
+        unsigned int wrap = wb_wrap_beats(burst_type);
+        bte = (wrap == words && wid == len && (adr & (wrap - 1)) == 0) ? burst_type : WB_BTE_LINEAR;
 
-        while (true) {
-            wait(ack_event);
-            wid -= len;
-            if (wid == 0) break;
-            state = _state;
-            adr += len;
-            ptr += len;
-            if (byt)
-                byt += len;
-        }
+        state = (cmd == tlm::tlm_command::TLM_WRITE_COMMAND) ? EXECUTING_WRITE : EXECUTING_READ;
+        wait(ack_event);
         trans.set_response_status( tlm::TLM_OK_RESPONSE );
     }
 
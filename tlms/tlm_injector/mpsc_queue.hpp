@@ -0,0 +1,74 @@
+/**
+ * @file mpsc_queue.hpp
+ * @author Riverlane, 2020
+ *
+ */
+
+#ifndef __MPSC_QUEUE_H__
+#define __MPSC_QUEUE_H__
+
+#include <atomic>
+#include <utility>
+
+/**
+ * Unbounded lock-free multi-producer single-consumer queue (intrusive
+ * linked list with a stub node). `push` can be called from any thread,
+ * `pop` from a single consumer thread only.
+ * A push that is still in progress may be invisible to `pop` for a short
+ * while: producers are expected to signal the consumer after pushing.
+ */
+template<class T>
+class MPSCQueue {
+public:
+    MPSCQueue() : head(&stub), tail(&stub) {}
+
+    ~MPSCQueue() {
+        T value;
+        while (pop(value)) {}
+        // The last node popped is the current stub
+        if (tail != &stub)
+            delete tail;
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    void push(T value) {
+        Node* node = new Node(std::move(value));
+        Node* prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer thread only
+    bool empty() const {
+        return tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+    bool pop(T& value) {
+        Node* current = tail;
+        Node* next = current->next.load(std::memory_order_acquire);
+        if (!next)
+            return false;
+        value = std::move(next->value);
+        // `next` becomes the new stub
+        tail = next;
+        if (current != &stub)
+            delete current;
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next {nullptr};
+        T value;
+
+        Node() : value() {}
+        explicit Node(T&& v) : value(std::move(v)) {}
+    };
+
+    Node stub;
+    alignas(64) std::atomic<Node*> head;
+    alignas(64) Node* tail;
+};
+
+#endif //__MPSC_QUEUE_H__
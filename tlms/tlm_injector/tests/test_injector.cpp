@@ -0,0 +1,110 @@
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <systemc>
+#include <tlm.h>
+#include "tlms/tlm_injector/tlm_injector.hpp"
+#include "tlms/tlm_router/tlm_router.hpp"
+#include "tlms/commons/memory.h"
+#include "commons/assertions.hpp"
+
+using namespace std;
+
+const unsigned int NTHREADS = 4;
+const unsigned int NACCESSES = 32;
+
+// Runs the simulation while `agent` injects from another thread: sc_start
+// returns once the agent is done and its requests are completed
+void run_agent(TLMInjector& injector, function<void()> agent){
+    injector.hold();
+    thread t([&]() {
+        agent();
+        injector.release();
+    });
+    sc_start();
+    t.join();
+}
+
+// Each thread writes its own slice of the memory, then reads it back
+void producer(TLMInjector& injector, unsigned int id, vector<uint32_t>& readback){
+    vector<future<InjectionResult>> writes;
+    for (unsigned int i = 0; i < NACCESSES; i++) {
+        uint32_t value = (id << 16) | i;
+        writes.push_back(injector.write((id * NACCESSES + i) * 4, &value, 4));
+    }
+    for (auto& w : writes)
+        w.get();
+    for (unsigned int i = 0; i < NACCESSES; i++) {
+        InjectionResult result = injector.read((id * NACCESSES + i) * 4, 4).get();
+        if (result.status == tlm::TLM_OK_RESPONSE)
+            memcpy(&readback[i], result.data.data(), 4);
+    }
+}
+
+void test_concurrent_producers(TLMInjector& injector){
+    vector<vector<uint32_t>> readback(NTHREADS, vector<uint32_t>(NACCESSES, 0));
+    run_agent(injector, [&]() {
+        vector<thread> threads;
+        for (unsigned int t = 0; t < NTHREADS; t++)
+            threads.emplace_back(producer, ref(injector), t, ref(readback[t]));
+        for (auto& t : threads)
+            t.join();
+    });
+    checkValuesMatch<uint64_t>(2 * NTHREADS * NACCESSES, injector.completed(), "injector-completed");
+
+    for (unsigned int t = 0; t < NTHREADS; t++)
+        for (unsigned int i = 0; i < NACCESSES; i++)
+            checkValuesMatch<uint32_t>((t << 16) | i, readback[t][i], "injector-readback");
+}
+
+void test_callbacks(TLMInjector& injector){
+    uint64_t before = injector.completed();
+    uint32_t value = 0xCAFE;
+    bool write_done = false;
+    uint32_t read_value = 0;
+    sc_time read_time;
+    // Released right after submitting: the requests still complete
+    run_agent(injector, [&]() {
+        injector.write(0x10, &value, 4, [&](const InjectionResult& r) {
+            write_done = (r.status == tlm::TLM_OK_RESPONSE);
+        });
+        injector.read(0x10, 4, [&](const InjectionResult& r) {
+            memcpy(&read_value, r.data.data(), 4);
+            read_time = r.time;
+        });
+    });
+    checkValuesMatch<uint64_t>(before + 2, injector.completed(), "injector-callback-completed");
+    checkValuesMatch<bool>(true, write_done, "injector-callback-write");
+    checkValuesMatch<uint32_t>(0xCAFE, read_value, "injector-callback-read");
+    checkValuesMatch<bool>(true, read_time > SC_ZERO_TIME, "injector-callback-time");
+}
+
+void test_error_response(TLMInjector& injector){
+    // Past the end of the memory
+    future<InjectionResult> result;
+    run_agent(injector, [&]() {
+        result = injector.read(0x800, 4);
+    });
+    checkValuesMatch<int>(tlm::TLM_ADDRESS_ERROR_RESPONSE, result.get().status, "injector-error");
+}
+
+int sc_main(int argc, char** argv) {
+
+    TLMInjector injector("injector");
+    Memory<0x100> mem = Memory<0x100>("memory");
+    TLMRouter<1, 1> router = TLMRouter<1, 1>("router", "/workdir/build/tlm_injector.csv");
+
+    injector.socket.bind(*(router.target_socket[0]));
+    router.initiator_socket[0]->bind(mem.socket);
+    router.setInitiatorProperties(0, {0x0, 0x1000, 0xFFF});
+
+    try {
+        test_concurrent_producers(injector);
+        test_callbacks(injector);
+        test_error_response(injector);
+    } catch (const std::exception& ex) {
+        SC_REPORT_ERROR("TEST_FAILURE", ex.what());
+    }
+    return 0;
+}
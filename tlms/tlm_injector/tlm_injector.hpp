@@ -0,0 +1,213 @@
+/**
+ * @file tlm_injector.hpp
+ * @author Riverlane, 2020
+ *
+ */
+
+#ifndef __TLM_INJECTOR_H__
+#define __TLM_INJECTOR_H__
+
+#include "systemc"
+#include "tlm"
+#include "tlm_utils/simple_initiator_socket.h"
+#include "tlm_utils/tlm_quantumkeeper.h"
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+#include "tlms/tlm_injector/mpsc_queue.hpp"
+
+using namespace sc_core;
+
+/**
+ * Outcome of an injected transaction
+ */
+struct InjectionResult {
+    tlm::tlm_response_status status;
+    std::vector<unsigned char> data;    // data read (or written)
+    sc_time time;                       // simulation time of the completion
+};
+
+/**
+ * TLMInjector lets threads outside of SystemC (test agents, co-simulators,
+ * load generators) issue transactions into the model.
+ *
+ * `read` and `write` can be called from any OS thread: requests go through a
+ * lock-free queue and the kernel is woken with async_request_update, so no
+ * polling is involved. They are issued in order through `socket` with
+ * b_transport, from a SystemC thread that is temporally decoupled: annotated
+ * delays are accumulated and the thread only synchronises with the kernel at
+ * the global quantum (tlm_quantumkeeper::set_global_quantum) or when the
+ * queue runs empty.
+ * Completions are returned either through a future or through a callback;
+ * callbacks run in the SystemC thread and must not block.
+ * The kernel only picks up requests while the simulation runs, e.g. while
+ * sc_main is inside sc_start. Between `hold` and `release` the kernel waits
+ * for requests instead of returning from sc_start when it runs out of
+ * events, so sc_main can run a plain sc_start() while other threads inject.
+ */
+struct TLMInjector: sc_module
+{
+    typedef std::function<void(const InjectionResult&)> Callback;
+
+    tlm_utils::simple_initiator_socket<TLMInjector> socket;
+
+    std::future<InjectionResult> read(uint64_t address, unsigned int len) {
+        Request* req = new Request(tlm::TLM_READ_COMMAND, address, len);
+        std::future<InjectionResult> result = req->promise.get_future();
+        submit(req);
+        return result;
+    }
+
+    std::future<InjectionResult> write(uint64_t address, const void* data, unsigned int len) {
+        Request* req = new Request(tlm::TLM_WRITE_COMMAND, address, len);
+        memcpy(req->data.data(), data, len);
+        std::future<InjectionResult> result = req->promise.get_future();
+        submit(req);
+        return result;
+    }
+
+    void read(uint64_t address, unsigned int len, Callback callback) {
+        Request* req = new Request(tlm::TLM_READ_COMMAND, address, len);
+        req->callback = std::move(callback);
+        submit(req);
+    }
+
+    void write(uint64_t address, const void* data, unsigned int len, Callback callback) {
+        Request* req = new Request(tlm::TLM_WRITE_COMMAND, address, len);
+        memcpy(req->data.data(), data, len);
+        req->callback = std::move(callback);
+        submit(req);
+    }
+
+    /**
+     * Number of requests submitted / completed so far (any thread)
+     */
+    uint64_t submitted() const {
+        return n_submitted.load(std::memory_order_relaxed);
+    }
+
+    uint64_t completed() const {
+        return n_completed.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Keeps sc_start running, waiting for requests, until `release`.
+     * Both can be called from any thread.
+     */
+    void hold() {
+        doorbell.hold();
+    }
+
+    /**
+     * Lets sc_start return once the requests submitted so far are completed
+     */
+    void release() {
+        doorbell.release();
+    }
+
+    SC_CTOR(TLMInjector)
+        : socket("socket"), doorbell("doorbell")
+    {
+        SC_THREAD(issue);
+    }
+
+    ~TLMInjector() {
+        // Requests never issued: their futures report a broken promise
+        Request* req;
+        while (queue.pop(req))
+            delete req;
+    }
+
+private:
+    struct Request {
+        tlm::tlm_command cmd;
+        uint64_t address;
+        std::vector<unsigned char> data;
+        std::promise<InjectionResult> promise;
+        Callback callback;
+
+        Request(tlm::tlm_command c, uint64_t a, unsigned int len)
+            : cmd(c), address(a), data(len) {}
+    };
+
+    // Turns an update request from another thread into a SystemC event
+    struct Doorbell: sc_prim_channel {
+        sc_event event;
+        std::atomic<bool> releasing {false};
+
+        explicit Doorbell(const char* name) : sc_prim_channel(name) {}
+
+        void ring() {
+            async_request_update();
+        }
+
+        void hold() {
+            async_attach_suspending();
+        }
+
+        // Detached from the kernel side, after the requests pushed before
+        // this call are visible, so none is left behind
+        void release() {
+            releasing.store(true, std::memory_order_release);
+            ring();
+        }
+
+        virtual void update() {
+            if (releasing.exchange(false, std::memory_order_acq_rel))
+                async_detach_suspending();
+            event.notify(SC_ZERO_TIME);
+        }
+    };
+
+    MPSCQueue<Request*> queue;
+    Doorbell doorbell;
+    std::atomic<uint64_t> n_submitted {0};
+    std::atomic<uint64_t> n_completed {0};
+
+    void submit(Request* req) {
+        n_submitted.fetch_add(1, std::memory_order_relaxed);
+        queue.push(req);
+        doorbell.ring();
+    }
+
+    void issue() {
+        tlm::tlm_generic_payload trans;
+        tlm_utils::tlm_quantumkeeper qk;
+        qk.reset();
+        Request* next;
+        while (true) {
+            while (queue.pop(next)) {
+                std::unique_ptr<Request> req(next);
+                sc_time delay = qk.get_local_time();
+                trans.set_command( req->cmd );
+                trans.set_address( req->address );
+                trans.set_data_ptr( req->data.data() );
+                trans.set_data_length( req->data.size() );
+                trans.set_streaming_width( req->data.size() );
+                trans.set_byte_enable_ptr( 0 );
+                trans.set_dmi_allowed( false );
+                trans.set_response_status( tlm::TLM_INCOMPLETE_RESPONSE );
+                socket->b_transport( trans, delay );
+                qk.set( delay );
+
+                InjectionResult result {trans.get_response_status(), std::move(req->data), qk.get_current_time()};
+                n_completed.fetch_add(1, std::memory_order_relaxed);
+                if (req->callback)
+                    req->callback(result);
+                else
+                    req->promise.set_value(std::move(result));
+                if (qk.need_sync())
+                    qk.sync();
+            }
+            qk.sync();
+            // Requests pushed while syncing rang a doorbell that nobody waited for
+            if (queue.empty())
+                wait(doorbell.event);
+        }
+    }
+};
+
+#endif //__TLM_INJECTOR_H__
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <systemc>
+#include <tlm.h>
+#include "tlms/tlm_memories/tlm_ram.hpp"
+#include "tlms/commons/initiator.h"
+#include "commons/assertions.hpp"
+
+using namespace std;
+
+const uint64_t RAM_SIZE = 4ULL * 1024 * 1024 * 1024;
+
+void test_sparse_accesses(Initiator& init, TLM_RAM& ram){
+    const uint32_t addresses[] = {0x0, 0x1000, 0x40000000, 0x80000004, 0xFFFFFFFC};
+    uint32_t value;
+    for (uint32_t address : addresses) {
+        value = address ^ 0xA5A5A5A5;
+        _initiator_dowrite(init, &value, address);
+    }
+    for (uint32_t address : addresses) {
+        _initiator_doread(init, &value, address);
+        checkValuesMatch<uint32_t>(address ^ 0xA5A5A5A5, value, "ram-readback");
+    }
+    // Never written: reads as zero
+    _initiator_doread(init, &value, 0x20000000);
+    checkValuesMatch<uint32_t>(0, value, "ram-untouched");
+
+    // A handful of pages (huge pages at most) are resident, not 4 GiB
+    cout << "TLM_RAM resident bytes: " << ram.resident_bytes() << endl;
+    checkValuesMatch<bool>(true, ram.resident_bytes() < 64 * 1024 * 1024, "ram-resident");
+}
+
+void test_byte_enables(Initiator& init){
+    uint32_t value = 0x11223344;
+    _initiator_dowrite(init, &value, 0x2000);
+    value = 0xAABBCCDD;
+    uint8_t mask[4] = {0xFF, 0x00, 0xFF, 0x00};
+    _initiator_dowrite(init, &value, 0x2000, 4, 4, mask);
+    _initiator_doread(init, &value, 0x2000);
+    checkValuesMatch<uint32_t>(0x11BB33DD, value, "ram-byte-enables");
+}
+
+void test_dmi_and_dbg(TLM_RAM& ram){
+    tlm::tlm_generic_payload trans;
+    tlm::tlm_dmi dmi;
+    trans.set_address(0x40000000);
+    checkValuesMatch<bool>(true, ram.get_direct_mem_ptr(trans, dmi), "ram-dmi");
+    checkValuesMatch<uint64_t>(RAM_SIZE - 1, dmi.get_end_address(), "ram-dmi-end");
+    uint32_t value;
+    memcpy(&value, dmi.get_dmi_ptr() + 0x40000000, 4);
+    checkValuesMatch<uint32_t>(0x40000000 ^ 0xA5A5A5A5, value, "ram-dmi-data");
+
+    // Debug reads are clipped at the end of the memory
+    uint8_t buf[16];
+    trans.set_command(tlm::TLM_READ_COMMAND);
+    trans.set_address(RAM_SIZE - 4);
+    trans.set_data_ptr(buf);
+    trans.set_data_length(16);
+    checkValuesMatch<unsigned int>(4, ram.transport_dbg(trans), "ram-dbg-clip");
+}
+
+void test_out_of_range(TLM_RAM& ram){
+    tlm::tlm_generic_payload trans;
+    sc_time delay = SC_ZERO_TIME;
+    uint32_t value;
+    trans.set_command(tlm::TLM_READ_COMMAND);
+    trans.set_address(RAM_SIZE - 2);
+    trans.set_data_ptr(reinterpret_cast<unsigned char*>(&value));
+    trans.set_data_length(4);
+    trans.set_streaming_width(4);
+    ram.b_transport(trans, delay);
+    checkValuesMatch<int>(tlm::TLM_ADDRESS_ERROR_RESPONSE, trans.get_response_status(), "ram-out-of-range");
+}
+
+void test_zero_streaming_width(TLM_RAM& ram){
+    // Invalid per the LRM, as in Memory
+    tlm::tlm_generic_payload trans;
+    sc_time delay = SC_ZERO_TIME;
+    uint32_t value;
+    trans.set_command(tlm::TLM_READ_COMMAND);
+    trans.set_address(0x0);
+    trans.set_data_ptr(reinterpret_cast<unsigned char*>(&value));
+    trans.set_data_length(4);
+    trans.set_streaming_width(0);
+    ram.b_transport(trans, delay);
+    checkValuesMatch<int>(tlm::TLM_BURST_ERROR_RESPONSE, trans.get_response_status(), "ram-zero-width");
+}
+
+int sc_main(int argc, char** argv) {
+
+    Initiator init("init");
+    TLM_RAM ram("ram", RAM_SIZE, sc_time(10, SC_NS));
+    init.socket.bind(ram.socket);
+
+    try {
+        test_sparse_accesses(init, ram);
+        test_byte_enables(init);
+        test_dmi_and_dbg(ram);
+        test_out_of_range(ram);
+        test_zero_streaming_width(ram);
+    } catch (const std::exception& ex) {
+        SC_REPORT_ERROR("TEST_FAILURE", ex.what());
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <systemc>
+#include <tlm.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "tlms/tlm_memories/tlm_rom.hpp"
+#include "commons/assertions.hpp"
+
+using namespace std;
+
+const char* IMAGE = "/workdir/models/memories/tests/image_for_storage.img";
+const char* LARGE_IMAGE = "/workdir/build/tlm_rom_large.img";
+const size_t BASE = 0x1000;
+
+vector<unsigned char> read_file(const char* path){
+    ifstream file(path, ios::in | ios::binary);
+    return vector<unsigned char>((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+}
+
+tlm::tlm_response_status rom_access(TLM_ROM& rom, tlm::tlm_command cmd, uint64_t address,
+                                    unsigned char* data, unsigned int len){
+    tlm::tlm_generic_payload trans;
+    sc_time delay = SC_ZERO_TIME;
+    trans.set_command(cmd);
+    trans.set_address(address);
+    trans.set_data_ptr(data);
+    trans.set_data_length(len);
+    trans.set_streaming_width(len);
+    trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+    rom.b_transport(trans, delay);
+    return trans.get_response_status();
+}
+
+void test_read(TLM_ROM& rom, const vector<unsigned char>& expected){
+    vector<unsigned char> data(expected.size(), 0);
+    checkValuesMatch<int>(tlm::TLM_OK_RESPONSE,
+                          rom_access(rom, tlm::TLM_READ_COMMAND, BASE, data.data(), data.size()), "rom-read");
+    checkValuesMatch<unsigned char>(expected, data, "rom-read-data");
+}
+
+void test_errors(TLM_ROM& rom){
+    uint32_t value = 0;
+    unsigned char* ptr = reinterpret_cast<unsigned char*>(&value);
+    bool ex_triggered = false;
+    try {
+        rom_access(rom, tlm::TLM_WRITE_COMMAND, BASE, ptr, 4);
+    } catch (const sc_core::sc_report& ex) {
+        ex_triggered = true;
+    }
+    checkValuesMatch<bool>(true, ex_triggered, "rom-write-error");
+
+    // Crossing the end of the image
+    ex_triggered = false;
+    try {
+        rom_access(rom, tlm::TLM_READ_COMMAND, BASE + rom.image_size - 2, ptr, 4);
+    } catch (const sc_core::sc_report& ex) {
+        ex_triggered = true;
+    }
+    checkValuesMatch<bool>(true, ex_triggered, "rom-range-error");
+}
+
+void test_dmi(TLM_ROM& rom, const vector<unsigned char>& expected){
+    tlm::tlm_generic_payload trans;
+    tlm::tlm_dmi dmi;
+    trans.set_command(tlm::TLM_READ_COMMAND);
+    trans.set_address(BASE);
+    checkValuesMatch<bool>(true, rom.get_direct_mem_ptr(trans, dmi), "rom-dmi");
+    checkValuesMatch<bool>(true, dmi.is_read_allowed(), "rom-dmi-read");
+    checkValuesMatch<bool>(false, dmi.is_write_allowed(), "rom-dmi-no-write");
+    checkValuesMatch<uint64_t>(BASE, dmi.get_start_address(), "rom-dmi-start");
+    checkValuesMatch<uint64_t>(BASE + expected.size() - 1, dmi.get_end_address(), "rom-dmi-end");
+    vector<unsigned char> data(dmi.get_dmi_ptr(), dmi.get_dmi_ptr() + expected.size());
+    checkValuesMatch<unsigned char>(expected, data, "rom-dmi-data");
+}
+
+void test_debug_patch(TLM_ROM& rom, const vector<unsigned char>& expected){
+    tlm::tlm_generic_payload trans;
+    unsigned char patch[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+    trans.set_command(tlm::TLM_WRITE_COMMAND);
+    trans.set_address(BASE + 8);
+    trans.set_data_ptr(patch);
+    trans.set_data_length(4);
+    checkValuesMatch<unsigned int>(4, rom.transport_dbg(trans), "rom-patch");
+
+    unsigned char back[4];
+    rom_access(rom, tlm::TLM_READ_COMMAND, BASE + 8, back, 4);
+    checkValuesMatch<unsigned int>(0xEF, back[3], "rom-patched");
+    // The image on disk is untouched
+    checkValuesMatch<unsigned char>(expected, read_file(IMAGE), "rom-file-untouched");
+}
+
+void test_large_image(){
+    // 1 GiB sparse image: mapping it is immediate and nothing is read upfront
+    const size_t size = 1ULL << 30;
+    int fd = open(LARGE_IMAGE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    checkValuesMatch<bool>(true, fd >= 0 && ftruncate(fd, size) == 0, "rom-large-create");
+    uint32_t marker = 0x600DB007;
+    checkValuesMatch<bool>(true, pwrite(fd, &marker, 4, size - 4) == 4, "rom-large-marker");
+    close(fd);
+
+    TLM_ROM large("large_rom", 0, LARGE_IMAGE);
+    uint32_t value = 0;
+    rom_access(large, tlm::TLM_READ_COMMAND, size - 4, reinterpret_cast<unsigned char*>(&value), 4);
+    checkValuesMatch<uint32_t>(marker, value, "rom-large-read");
+    unlink(LARGE_IMAGE);
+}
+
+int sc_main(int argc, char** argv) {
+
+    TLM_ROM rom("rom", BASE, IMAGE);
+    vector<unsigned char> expected = read_file(IMAGE);
+
+    try {
+        test_read(rom, expected);
+        test_errors(rom);
+        test_dmi(rom, expected);
+        test_debug_patch(rom, expected);
+        test_large_image();
+    } catch (const std::exception& ex) {
+        SC_REPORT_ERROR("TEST_FAILURE", ex.what());
+    }
+    return 0;
+}
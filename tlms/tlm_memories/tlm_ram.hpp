@@ -0,0 +1,157 @@
+/**
+ * @file tlm_ram.hpp
+ * @author Riverlane, 2020
+ *
+ */
+
+#ifndef __TLM_RAM_H__
+#define __TLM_RAM_H__
+
+#include <systemc>
+#include "tlm.h"
+#include "tlm_utils/simple_target_socket.h"
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace sc_core;
+using namespace std;
+
+/**
+ * TLM_RAM implements a read-write memory whose size is set at runtime and can
+ * span several gigabytes.
+ *
+ * The storage is an anonymous mapping reserved with MAP_NORESERVE: the kernel
+ * only backs a page when it is first written (reads of untouched pages return
+ * zeros without allocating), so the resident memory follows the working set
+ * of the simulation rather than `size`. When `huge_pages` is set, transparent
+ * huge pages are requested for the region.
+ * As the mapping is contiguous a single DMI region covers the whole memory.
+ * Accesses never wait: `latency` is added to the annotated delay.
+ */
+SC_MODULE(TLM_RAM) {
+
+    tlm_utils::simple_target_socket<TLM_RAM> socket;
+
+    uint64_t size;
+    sc_time latency;
+    unsigned char* storage {nullptr};
+
+    TLM_RAM(sc_module_name name, uint64_t size_, const sc_time& latency_ = SC_ZERO_TIME,
+            bool huge_pages = true)
+        : socket("socket"), size(size_), latency(latency_)
+    {
+        void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (ptr == MAP_FAILED) {
+            std::stringstream err;
+            err << "TLM_RAM: cannot reserve 0x" << hex << size << " bytes";
+            SC_REPORT_ERROR("TLM_RAM", err.str().c_str());
+            return;
+        }
+        storage = static_cast<unsigned char*>(ptr);
+#ifdef MADV_HUGEPAGE
+        if (huge_pages)
+            madvise(storage, size, MADV_HUGEPAGE);
+#endif
+        socket.register_b_transport(this, &TLM_RAM::b_transport);
+        socket.register_get_direct_mem_ptr(this, &TLM_RAM::get_direct_mem_ptr);
+        socket.register_transport_dbg(this, &TLM_RAM::transport_dbg);
+    }
+
+    ~TLM_RAM() {
+        if (storage)
+            munmap(storage, size);
+    }
+
+    void b_transport(tlm::tlm_generic_payload& trans, sc_time& delay) {
+        tlm::tlm_command cmd = trans.get_command();
+        sc_dt::uint64    addr = trans.get_address();
+        unsigned char*   ptr = trans.get_data_ptr();
+        unsigned int     len = trans.get_data_length();
+        unsigned char*   byt = trans.get_byte_enable_ptr();
+        unsigned int     wid = trans.get_streaming_width();
+
+        if (wid == 0) {
+            trans.set_response_status( tlm::TLM_BURST_ERROR_RESPONSE );
+            return;
+        }
+        if (wid > len)
+            wid = len;
+        if (addr >= size || wid > size - addr) {
+            trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
+            return;
+        }
+
+        if (!byt && wid == len) {
+            if ( cmd == tlm::TLM_READ_COMMAND )
+                memcpy(ptr, storage + addr, len);
+            else if ( cmd == tlm::TLM_WRITE_COMMAND )
+                memcpy(storage + addr, ptr, len);
+        } else {
+            // Streaming width and byte enables: byte by byte
+            unsigned int byt_len = trans.get_byte_enable_length();
+            if (byt_len == 0)
+                byt_len = len;
+            for (unsigned int i = 0; i < len; i++) {
+                if (byt && byt[i % byt_len] != tlm::TLM_BYTE_ENABLED)
+                    continue;
+                unsigned char* cell = storage + addr + (i % wid);
+                if ( cmd == tlm::TLM_READ_COMMAND )
+                    ptr[i] = *cell;
+                else if ( cmd == tlm::TLM_WRITE_COMMAND )
+                    *cell = ptr[i];
+            }
+        }
+
+        delay += latency;
+        trans.set_dmi_allowed(true);
+        trans.set_response_status( tlm::TLM_OK_RESPONSE );
+    }
+
+    // TLM-2 DMI method
+    bool get_direct_mem_ptr(tlm::tlm_generic_payload& trans, tlm::tlm_dmi& dmi_data) {
+        dmi_data.allow_read_write();
+        dmi_data.set_dmi_ptr( storage );
+        dmi_data.set_start_address( 0 );
+        dmi_data.set_end_address( size - 1 );
+        dmi_data.set_read_latency( latency );
+        dmi_data.set_write_latency( latency );
+        return true;
+    }
+
+    // TLM-2 debug transaction method
+    unsigned int transport_dbg(tlm::tlm_generic_payload& trans) {
+        tlm::tlm_command cmd = trans.get_command();
+        sc_dt::uint64    addr = trans.get_address();
+        unsigned char*   ptr = trans.get_data_ptr();
+        unsigned int     len = trans.get_data_length();
+
+        if (addr >= size)
+            return 0;
+        unsigned int num_bytes = std::min<sc_dt::uint64>(len, size - addr);
+        if ( cmd == tlm::TLM_READ_COMMAND )
+            memcpy(ptr, storage + addr, num_bytes);
+        else if ( cmd == tlm::TLM_WRITE_COMMAND )
+            memcpy(storage + addr, ptr, num_bytes);
+        return num_bytes;
+    }
+
+    /**
+     * Number of bytes of the memory currently backed by physical pages
+     */
+    uint64_t resident_bytes() const {
+        const uint64_t page = sysconf(_SC_PAGESIZE);
+        std::vector<unsigned char> pages((size + page - 1) / page);
+        if (mincore(storage, size, pages.data()) != 0)
+            return 0;
+        uint64_t resident = 0;
+        for (unsigned char p : pages)
+            resident += p & 1;
+        return resident * page;
+    }
+};
+
+#endif //__TLM_RAM_H__
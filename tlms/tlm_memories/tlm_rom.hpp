@@ -4,16 +4,31 @@
  *
  */
 
+#ifndef __TLM_ROM_H__
+#define __TLM_ROM_H__
+
 #include <systemc>
 #include "tlm.h"
 #include "tlm_utils/simple_target_socket.h"
+#include <cstring>
 #include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+using namespace sc_core;
 using namespace std;
 
 /**
  * TLM_ROM implements a basic rom memory that exposes one 
  * TLM socket.
+ * The image is mapped into memory rather than read, so start-up does not
+ * depend on its size, and reads are served with memcpy. Read-only DMI is
+ * granted over the whole image.
+ * The mapping is private: debug writes (transport_dbg) patch the simulated
+ * ROM without ever reaching the file.
+ * Accesses never wait: `latency` is added to the annotated delay.
 */
 SC_MODULE(TLM_ROM) {
 
@@ -21,17 +36,49 @@ SC_MODULE(TLM_ROM) {
     tlm_utils::simple_target_socket<TLM_ROM> dataBus;
 
     size_t baseaddr;
-    std::vector<unsigned char> ROM;
+    unsigned char* image {nullptr};
+    size_t image_size {0};
+    sc_time latency;
 
-    TLM_ROM(sc_module_name name, size_t baseaddr_, const char* rom_path) {
-        std::ifstream file(rom_path, std::ios::in | std::ios::binary);
-        ROM = std::vector<unsigned char>((std::istreambuf_iterator<char>(file)),
-                                         std::istreambuf_iterator<char>());
+    TLM_ROM(sc_module_name name, size_t baseaddr_, const char* rom_path,
+            const sc_time& latency_ = SC_ZERO_TIME) : latency(latency_) {
+        map_image(rom_path);
         cout << "initalised the ROM for module " << name << endl;
         baseaddr = baseaddr_;
         dataBus.register_b_transport(this, &TLM_ROM::b_transport);
+        dataBus.register_get_direct_mem_ptr(this, &TLM_ROM::get_direct_mem_ptr);
+        dataBus.register_transport_dbg(this, &TLM_ROM::transport_dbg);
     };
 
+    ~TLM_ROM() {
+        if (image)
+            munmap(image, image_size);
+    }
+
+    void map_image(const char* rom_path) {
+        int fd = open(rom_path, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0)
+                close(fd);
+            std::string err = std::string("TLM_ROM: cannot open image ") + rom_path;
+            SC_REPORT_ERROR("TLM_ROM", err.c_str());
+            return;
+        }
+        image_size = st.st_size;
+        if (image_size) {
+            void* ptr = mmap(nullptr, image_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (ptr == MAP_FAILED) {
+                image_size = 0;
+                std::string err = std::string("TLM_ROM: cannot map image ") + rom_path;
+                SC_REPORT_ERROR("TLM_ROM", err.c_str());
+            } else {
+                image = static_cast<unsigned char*>(ptr);
+            }
+        }
+        close(fd);
+    }
+
     void b_transport(tlm::tlm_generic_payload& trans, sc_time& delay) {
         tlm::tlm_command cmd = trans.get_command();
         sc_dt::uint64    addr = trans.get_address();
@@ -39,34 +86,77 @@ SC_MODULE(TLM_ROM) {
         unsigned int     len = trans.get_data_length();
         addr -= baseaddr;
 
-        std::stringstream info;
-        info << "TLM_ROM: got a generic transaction "<<
-             "\n cmd: " << cmd <<
-             "\n addr: " << addr <<
-             "\n raw transaction addr: " << trans.get_address() <<
-             "\n data ptr: " << (size_t)ptr <<
-             "\n data len: " << len <<
-             "\n delay: " << delay;
-        SC_REPORT_INFO_VERB("TLM_ROM", info.str().c_str(), SC_DEBUG);
-
-        if (addr >= ROM.size()) {
-            std::stringstream err;
-            err << "TLM_ROM: relative address " << hex << addr << " is outside memory [Memory size is " << ROM.size() << "]";
-            SC_REPORT_ERROR("TLM_ROM", err.str().c_str());
+        if (sc_report_handler::get_verbosity_level() >= SC_DEBUG) {
+            std::stringstream info;
+            info << "TLM_ROM: got a generic transaction "<<
+                 "\n cmd: " << cmd <<
+                 "\n addr: " << addr <<
+                 "\n raw transaction addr: " << trans.get_address() <<
+                 "\n data ptr: " << (size_t)ptr <<
+                 "\n data len: " << len <<
+                 "\n delay: " << delay;
+            SC_REPORT_INFO_VERB("TLM_ROM", info.str().c_str(), SC_DEBUG);
+        }
+
+        if (addr >= image_size || len > image_size - addr) {
+            report_out_of_range(addr);
             trans.set_response_status(tlm::TLM_ADDRESS_ERROR_RESPONSE);
             return;
         }
 
-        if ( cmd == tlm::TLM_READ_COMMAND ) {
-            for (size_t i=0; i<len; i++) {
-                ptr[i] = ROM[addr+i];
-            }
-        }
         if ( cmd == tlm::TLM_WRITE_COMMAND ) {
             trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE ); // write disabled
             SC_REPORT_ERROR("TLM_ROM", "TLM_ROM: write not allowed on ROMs");
+            return;
         }
+        if ( cmd == tlm::TLM_READ_COMMAND )
+            memcpy(ptr, image + addr, len);
 
+        delay += latency;
+        trans.set_dmi_allowed(true);
         trans.set_response_status( tlm::TLM_OK_RESPONSE );
     }
+
+    // TLM-2 DMI method: read-only access to the whole image
+    bool get_direct_mem_ptr(tlm::tlm_generic_payload& trans, tlm::tlm_dmi& dmi_data) {
+        if (!image || trans.get_command() == tlm::TLM_WRITE_COMMAND)
+            return false;
+        dmi_data.allow_read();
+        dmi_data.set_dmi_ptr( image );
+        dmi_data.set_start_address( baseaddr );
+        dmi_data.set_end_address( baseaddr + image_size - 1 );
+        dmi_data.set_read_latency( latency );
+        return true;
+    }
+
+    // TLM-2 debug transaction method.
+    // Debug writes are a backdoor: they are allowed so that images can be patched.
+    unsigned int transport_dbg(tlm::tlm_generic_payload& trans) {
+        tlm::tlm_command cmd = trans.get_command();
+        sc_dt::uint64    addr = trans.get_address() - baseaddr;
+        unsigned char*   ptr = trans.get_data_ptr();
+        unsigned int     len = trans.get_data_length();
+
+        if (addr >= image_size)
+            return 0;
+        // Calculate the number of bytes to be actually copied
+        unsigned int num_bytes = std::min<sc_dt::uint64>(len, image_size - addr);
+
+        if ( cmd == tlm::TLM_READ_COMMAND )
+            memcpy(ptr, image + addr, num_bytes);
+        else if ( cmd == tlm::TLM_WRITE_COMMAND )
+            memcpy(image + addr, ptr, num_bytes);
+
+        return num_bytes;
+    }
+
+private:
+    // Kept out of line: the message is only formatted when an error occurs
+    void report_out_of_range(sc_dt::uint64 addr) {
+        std::stringstream err;
+        err << "TLM_ROM: relative address " << hex << addr << " is outside memory [Memory size is " << image_size << "]";
+        SC_REPORT_ERROR("TLM_ROM", err.str().c_str());
+    }
 };
+
+#endif //__TLM_ROM_H__
@@ -0,0 +1,133 @@
+/**
+ * @file address_decoder.hpp
+ * @author Riverlane, 2020
+ *
+ */
+
+#ifndef __ADDRESS_DECODER_H__
+#define __ADDRESS_DECODER_H__
+
+#include "systemc"
+#include <algorithm>
+#include <cstdint>
+#include <sstream> // std::stringstream
+#include <vector>
+
+/**
+ * Address window served by one of the router's initiator sockets.
+ * An access is routed when baseAddress <= address < topAddress and is
+ * forwarded as (address & mask).
+ */
+struct InitiatorConfig {
+    uint64_t baseAddress;
+    uint64_t topAddress;
+    uint64_t mask;
+};
+
+/**
+ * Returns the low address bits that a mask passes through unchanged
+ * (its trailing ones). Inside a block of that size the mask maps addresses
+ * one-to-one onto a contiguous downstream range.
+ */
+inline uint64_t linear_bits(uint64_t mask) {
+    return (~mask & (mask + 1)) - 1;
+}
+
+/**
+ * AddressDecoder maps an address onto one of a set of non-overlapping regions.
+ * The regions are kept sorted by base address so a lookup is a binary search.
+ * Callers can pass the region they hit last as a hint: when consecutive
+ * accesses fall into the same region the search is skipped altogether.
+ */
+class AddressDecoder {
+public:
+    static constexpr bool is_static = false;
+
+    struct Region {
+        uint64_t baseAddress;
+        uint64_t topAddress;
+        uint64_t mask;
+        unsigned int index;
+
+        inline bool contains(uint64_t address) const {
+            return (address >= baseAddress) && (address < topAddress);
+        }
+
+        /**
+         * Largest range [low, high] of this region around `address` that is
+         * mapped contiguously onto the downstream address space.
+         */
+        inline void linear_window(uint64_t address, uint64_t& low, uint64_t& high) const {
+            uint64_t bits = linear_bits(mask);
+            low = std::max(baseAddress, address & ~bits);
+            high = std::min(topAddress - 1, address | bits);
+        }
+    };
+
+    void clear() {
+        regions.clear();
+    }
+
+    /**
+     * Registers the window of initiator `index`. Empty windows
+     * (topAddress <= baseAddress) are not mapped.
+     */
+    void add(unsigned int index, const InitiatorConfig& config) {
+        if (config.topAddress <= config.baseAddress)
+            return;
+        regions.push_back({config.baseAddress, config.topAddress, config.mask, index});
+    }
+
+    /**
+     * Sorts the table and checks that no two windows overlap.
+     * Must be called after the last `add` and before any `find`.
+     */
+    void build() {
+        std::sort(regions.begin(), regions.end(),
+        [](const Region& a, const Region& b) {
+            return a.baseAddress < b.baseAddress;
+        });
+        for (size_t i = 1; i < regions.size(); i++) {
+            if (regions[i].baseAddress < regions[i-1].topAddress) {
+                std::stringstream err;
+                err << "TLM-ROUTER: Address space of initiator " << regions[i-1].index
+                    << " [0x" << std::hex << regions[i-1].baseAddress << ", 0x" << regions[i-1].topAddress
+                    << ") overlaps with initiator " << std::dec << regions[i].index
+                    << " [0x" << std::hex << regions[i].baseAddress << ", 0x" << regions[i].topAddress << ")";
+                SC_REPORT_ERROR("TLM-ROUTER", err.str().c_str());
+            }
+        }
+    }
+
+    inline const Region* find(uint64_t address) const {
+        auto it = std::upper_bound(regions.begin(), regions.end(), address,
+        [](uint64_t a, const Region& r) {
+            return a < r.baseAddress;
+        });
+        if (it == regions.begin())
+            return nullptr;
+        --it;
+        return it->contains(address) ? &(*it) : nullptr;
+    }
+
+    /**
+     * Same as find(address), but checks `hint` first and updates it on a hit.
+     */
+    inline const Region* find(uint64_t address, const Region*& hint) const {
+        if (hint && hint->contains(address))
+            return hint;
+        const Region* region = find(address);
+        if (region)
+            hint = region;
+        return region;
+    }
+
+    size_t size() const {
+        return regions.size();
+    }
+
+private:
+    std::vector<Region> regions;
+};
+
+#endif //__ADDRESS_DECODER_H__
@@ -0,0 +1,173 @@
+/**
+ * @file binary_trace.hpp
+ * @author Riverlane, 2020
+ *
+ */
+
+#ifndef __BINARY_TRACE_H__
+#define __BINARY_TRACE_H__
+
+#include "systemc"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "tlms/tlm_router/trace_format.hpp"
+
+/**
+ * BinaryTraceWriter stores fixed-size TraceRecord into a memory-mapped file.
+ *
+ * The simulation thread only copies the record into a single-producer
+ * single-consumer lock-free ring buffer; a background thread drains the ring
+ * into the file, which is grown and mapped WINDOW_SIZE bytes at a time.
+ * When the ring is full the producer yields until there is space again, so
+ * no record is ever dropped.
+ * Use trace2csv (tlms/tlm_router/tools) to convert the file into CSV.
+ */
+class BinaryTraceWriter {
+public:
+    static constexpr uint64_t WINDOW_SIZE = 64 * 1024 * 1024;
+
+    /**
+     * @param filename output file, truncated if it exists
+     * @param capacity number of records in the ring buffer (rounded up to a power of two)
+     */
+    explicit BinaryTraceWriter(const char* filename, size_t capacity = 1 << 16) {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        ring.resize(size);
+        ring_mask = size - 1;
+
+        fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            std::string err = std::string("Cannot open binary trace file ") + filename;
+            SC_REPORT_ERROR("TLM-ROUTER", err.c_str());
+            return;
+        }
+        TraceHeader header;
+        init_trace_header(header);
+        write_bytes(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+        running = true;
+        worker = std::thread(&BinaryTraceWriter::drain, this);
+    }
+
+    ~BinaryTraceWriter() {
+        close();
+    }
+
+    /**
+     * Appends a record. Called from the simulation thread only.
+     */
+    inline void push(const TraceRecord& record) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - cached_tail > ring_mask) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            while (h - cached_tail > ring_mask) {
+                std::this_thread::yield();
+                cached_tail = tail.load(std::memory_order_acquire);
+            }
+        }
+        ring[h & ring_mask] = record;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    /**
+     * Number of records pushed so far
+     */
+    uint64_t size() const {
+        return head.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Drains the ring buffer, truncates the file to its final size and closes it
+     */
+    void close() {
+        if (fd < 0)
+            return;
+        running = false;
+        if (worker.joinable())
+            worker.join();
+        if (window)
+            munmap(window, WINDOW_SIZE);
+        window = nullptr;
+        if (failed || ftruncate(fd, file_pos) != 0)
+            SC_REPORT_WARNING("TLM-ROUTER", "Binary trace file is incomplete");
+        ::close(fd);
+        fd = -1;
+    }
+
+private:
+    std::vector<TraceRecord> ring;
+    uint64_t ring_mask {0};
+    alignas(64) std::atomic<uint64_t> head {0};
+    alignas(64) std::atomic<uint64_t> tail {0};
+    alignas(64) uint64_t cached_tail {0};
+    std::atomic<bool> running {false};
+    std::atomic<bool> failed {false};
+    std::thread worker;
+
+    int fd {-1};
+    uint8_t* window {nullptr};
+    uint64_t window_offset {0};
+    uint64_t file_pos {0};
+
+    void drain() {
+        while (true) {
+            uint64_t t = tail.load(std::memory_order_relaxed);
+            uint64_t h = head.load(std::memory_order_acquire);
+            if (t == h) {
+                if (!running.load(std::memory_order_acquire)) {
+                    if (head.load(std::memory_order_acquire) == t)
+                        break;
+                    continue;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+            while (t != h) {
+                // Largest contiguous span of the ring
+                uint64_t first = t & ring_mask;
+                uint64_t count = std::min<uint64_t>(h - t, ring.size() - first);
+                write_bytes(reinterpret_cast<const uint8_t*>(&ring[first]), count * sizeof(TraceRecord));
+                t += count;
+            }
+            tail.store(t, std::memory_order_release);
+        }
+    }
+
+    void write_bytes(const uint8_t* data, uint64_t size) {
+        while (size) {
+            if (!window || file_pos >= window_offset + WINDOW_SIZE) {
+                if (!map_window(file_pos - (file_pos % WINDOW_SIZE))) {
+                    failed = true;
+                    return;
+                }
+            }
+            uint64_t chunk = std::min<uint64_t>(size, window_offset + WINDOW_SIZE - file_pos);
+            memcpy(window + (file_pos - window_offset), data, chunk);
+            file_pos += chunk;
+            data += chunk;
+            size -= chunk;
+        }
+    }
+
+    bool map_window(uint64_t offset) {
+        if (window)
+            munmap(window, WINDOW_SIZE);
+        window = nullptr;
+        if (ftruncate(fd, offset + WINDOW_SIZE) != 0)
+            return false;
+        void* ptr = mmap(nullptr, WINDOW_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+        if (ptr == MAP_FAILED)
+            return false;
+        window = static_cast<uint8_t*>(ptr);
+        window_offset = offset;
+        return true;
+    }
+};
+
+#endif //__BINARY_TRACE_H__
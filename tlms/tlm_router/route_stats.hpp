@@ -0,0 +1,123 @@
+/**
+ * @file route_stats.hpp
+ * @author Riverlane, 2020
+ *
+ */
+
+#ifndef __ROUTE_STATS_H__
+#define __ROUTE_STATS_H__
+
+#include "systemc"
+#include "tlm"
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+using namespace sc_core;
+
+/**
+ * Counters of the transactions routed from one target socket to one
+ * initiator socket.
+ * delay_histogram[0] counts transactions with no delay, delay_histogram[k]
+ * those with a delay in [2^(k-1), 2^k) units of the time resolution.
+ */
+struct RouteCounters {
+    static constexpr unsigned int DELAY_BUCKETS = 65;
+
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t delay_histogram[DELAY_BUCKETS];
+
+    uint64_t transactions() const {
+        return reads + writes;
+    }
+
+    uint64_t bytes() const {
+        return read_bytes + write_bytes;
+    }
+
+    static inline unsigned int delay_bucket(uint64_t delay) {
+        return delay ? 64 - __builtin_clzll(delay) : 0;
+    }
+};
+
+/**
+ * RouteStats keeps one RouteCounters per (target socket, initiator socket)
+ * pair. Recording is a handful of plain integer increments: nothing goes
+ * through the SystemC scheduler.
+ */
+template<unsigned int N_TARGETS, unsigned int N_INITIATORS>
+class RouteStats {
+public:
+    typedef std::array<std::array<RouteCounters, N_INITIATORS>, N_TARGETS> Snapshot;
+
+    RouteStats() {
+        reset();
+    }
+
+    void reset() {
+        for (auto& row : counters)
+            for (RouteCounters& c : row)
+                c = RouteCounters{};
+    }
+
+    /**
+     * @param delay delay added by the route, in units of the time resolution
+     */
+    inline void record(unsigned int target, unsigned int initiator, tlm::tlm_command cmd,
+                       unsigned int len, uint64_t delay) {
+        RouteCounters& c = counters[target][initiator];
+        if (cmd == tlm::TLM_WRITE_COMMAND) {
+            c.writes++;
+            c.write_bytes += len;
+        } else {
+            c.reads++;
+            c.read_bytes += len;
+        }
+        c.delay_histogram[RouteCounters::delay_bucket(delay)]++;
+    }
+
+    const RouteCounters& get(unsigned int target, unsigned int initiator) const {
+        return counters[target][initiator];
+    }
+
+    /**
+     * Copy of all the counters, e.g. to compute the difference between two
+     * points of the simulation
+     */
+    Snapshot snapshot() const {
+        return counters;
+    }
+
+    /**
+     * Writes one CSV line per route that carried traffic. The histogram is
+     * written as the list of non-empty buckets "upper bound:count".
+     */
+    void dump(std::ostream& out) const {
+        out << "# " << sc_time_stamp() << std::endl;
+        out << "Target, Initiator, Reads, Writes, ReadBytes, WriteBytes, Delays" << std::endl;
+        for (unsigned int t = 0; t < N_TARGETS; t++) {
+            for (unsigned int i = 0; i < N_INITIATORS; i++) {
+                const RouteCounters& c = counters[t][i];
+                if (!c.transactions())
+                    continue;
+                out << t << ", " << i << ", " << c.reads << ", " << c.writes << ", "
+                    << c.read_bytes << ", " << c.write_bytes << ",";
+                for (unsigned int k = 0; k < RouteCounters::DELAY_BUCKETS; k++) {
+                    if (!c.delay_histogram[k])
+                        continue;
+                    uint64_t bound = k ? (k < 64 ? (uint64_t(1) << k) : ~uint64_t(0)) : 0;
+                    out << " <" << (k ? "" : "=") << sc_time::from_value(bound) << ":" << c.delay_histogram[k];
+                }
+                out << std::endl;
+            }
+        }
+    }
+
+private:
+    Snapshot counters;
+};
+
+#endif //__ROUTE_STATS_H__
@@ -0,0 +1,121 @@
+/**
+ * @file static_address_decoder.hpp
+ * @author Riverlane, 2020
+ *
+ */
+
+#ifndef __STATIC_ADDRESS_DECODER_H__
+#define __STATIC_ADDRESS_DECODER_H__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "tlms/tlm_router/address_decoder.hpp"
+
+/**
+ * Address window known at compile time, see InitiatorConfig.
+ */
+template<uint64_t BASE, uint64_t TOP, uint64_t MASK>
+struct MappedRegion {
+    static_assert(BASE < TOP, "MappedRegion: empty address window");
+    static constexpr uint64_t baseAddress = BASE;
+    static constexpr uint64_t topAddress = TOP;
+    static constexpr uint64_t mask = MASK;
+};
+
+/**
+ * StaticAddressDecoder is a drop-in replacement for AddressDecoder when the
+ * memory map is fixed at build time. Region i of the list is served by
+ * initiator socket i.
+ *
+ * The table is sorted and checked for overlaps at compile time, and `find`
+ * unrolls into a balanced tree of comparisons against constants. The Region
+ * returned is a compile-time constant too, so once inlined the mask is folded
+ * into the caller.
+ */
+template<class... REGIONS>
+class StaticAddressDecoder {
+public:
+    typedef AddressDecoder::Region Region;
+    static constexpr bool is_static = true;
+    static constexpr size_t N = sizeof...(REGIONS);
+    static_assert(N > 0, "StaticAddressDecoder: empty memory map");
+
+private:
+    static constexpr std::array<Region, N> make_table() {
+        const uint64_t base[N] = {REGIONS::baseAddress...};
+        const uint64_t top[N] = {REGIONS::topAddress...};
+        const uint64_t mask[N] = {REGIONS::mask...};
+        std::array<Region, N> table {};
+        for (size_t i = 0; i < N; i++)
+            table[i] = {base[i], top[i], mask[i], static_cast<unsigned int>(i)};
+        // Insertion sort on the base address
+        for (size_t i = 1; i < N; i++) {
+            for (size_t j = i; j > 0 && table[j].baseAddress < table[j-1].baseAddress; j--) {
+                Region tmp = table[j];
+                table[j] = table[j-1];
+                table[j-1] = tmp;
+            }
+        }
+        return table;
+    }
+
+    static constexpr std::array<Region, N> table = make_table();
+
+    static constexpr bool disjoint() {
+        for (size_t i = 1; i < N; i++)
+            if (table[i].baseAddress < table[i-1].topAddress)
+                return false;
+        return true;
+    }
+    static_assert(disjoint(), "StaticAddressDecoder: overlapping regions");
+
+    template<size_t LO, size_t HI>
+    static inline const Region* search(uint64_t address) {
+        if constexpr (LO == HI) {
+            return nullptr;
+        } else {
+            constexpr size_t MID = (LO + HI) / 2;
+            if (address < table[MID].baseAddress)
+                return search<LO, MID>(address);
+            if (address < table[MID].topAddress)
+                return &table[MID];
+            return search<MID + 1, HI>(address);
+        }
+    }
+
+public:
+    /**
+     * Configuration of initiator socket `index` as listed in the map
+     */
+    static InitiatorConfig config(unsigned int index) {
+        for (const Region& r : table)
+            if (r.index == index)
+                return {r.baseAddress, r.topAddress, r.mask};
+        return {0, 0, 0};
+    }
+
+    // The map cannot change: these only keep the AddressDecoder interface
+    void clear() {}
+    void add(unsigned int, const InitiatorConfig&) {}
+    void build() {}
+
+    inline const Region* find(uint64_t address) const {
+        return search<0, N>(address);
+    }
+
+    inline const Region* find(uint64_t address, const Region*& hint) const {
+        if (hint && hint->contains(address))
+            return hint;
+        const Region* region = find(address);
+        if (region)
+            hint = region;
+        return region;
+    }
+
+    size_t size() const {
+        return N;
+    }
+};
+
+#endif //__STATIC_ADDRESS_DECODER_H__
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <utility>
+#include <vector>
+#include <systemc>
+#include "tlms/tlm_router/address_decoder.hpp"
+#include "tlms/tlm_router/static_address_decoder.hpp"
+
+using namespace std;
+
+/**
+ * Micro-benchmark of the router address decoder.
+ * For memory maps from 2 to 256 regions we time:
+ *  - streaming accesses (consecutive addresses in the same region, served by the hint)
+ *  - random accesses spread across the whole map (binary search on every lookup)
+ * and the same map fixed at compile time (StaticAddressDecoder).
+ */
+const uint64_t REGION_STRIDE = 0x100000;
+const uint64_t REGION_SIZE = 0x80000;
+
+template<class DECODER>
+static double time_lookups(const DECODER& decoder, const vector<uint64_t>& addresses,
+                           unsigned int rounds, bool use_hint, uint64_t& checksum) {
+    const typename DECODER::Region* hint = nullptr;
+    auto start = chrono::steady_clock::now();
+    for (unsigned int r = 0; r < rounds; r++) {
+        for (uint64_t address : addresses) {
+            const typename DECODER::Region* region = use_hint ? decoder.find(address, hint) : decoder.find(address);
+            checksum += region->index;
+        }
+    }
+    auto stop = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(stop - start).count() / (double(rounds) * addresses.size());
+}
+
+template<size_t... I>
+StaticAddressDecoder<MappedRegion<I * REGION_STRIDE, I * REGION_STRIDE + REGION_SIZE, REGION_SIZE - 1>...>
+make_static_decoder(std::index_sequence<I...>);
+
+template<size_t N>
+using StaticDecoder = decltype(make_static_decoder(std::make_index_sequence<N>()));
+
+int sc_main(int argc, char** argv) {
+    const unsigned int NADDRESSES = 4096;
+    const unsigned int ROUNDS = 256;
+
+    mt19937_64 rng(0xDE17A);
+    uint64_t checksum = 0;
+
+    cout << "Regions, Streaming [ns/lookup], Random [ns/lookup], Random static [ns/lookup]" << endl;
+    for (unsigned int n = 2; n <= 256; n <<= 1) {
+        AddressDecoder decoder;
+        // Registering in reverse order so that build() has some sorting to do
+        for (unsigned int i = n; i-- > 0;)
+            decoder.add(i, {i * REGION_STRIDE, i * REGION_STRIDE + REGION_SIZE, REGION_SIZE - 1});
+        decoder.build();
+
+        vector<uint64_t> streaming(NADDRESSES);
+        vector<uint64_t> random(NADDRESSES);
+        uint64_t region = rng() % n;
+        for (unsigned int i = 0; i < NADDRESSES; i++) {
+            // bursts of 64 word accesses before moving to another region
+            if (i % 64 == 0)
+                region = rng() % n;
+            streaming[i] = region * REGION_STRIDE + (i % 64) * 4;
+            random[i] = (rng() % n) * REGION_STRIDE + (rng() % REGION_SIZE);
+        }
+
+        double t_streaming = time_lookups(decoder, streaming, ROUNDS, true, checksum);
+        double t_random = time_lookups(decoder, random, ROUNDS, false, checksum);
+        double t_static = 0;
+        switch (n) {
+        case 2: t_static = time_lookups(StaticDecoder<2>(), random, ROUNDS, false, checksum); break;
+        case 4: t_static = time_lookups(StaticDecoder<4>(), random, ROUNDS, false, checksum); break;
+        case 8: t_static = time_lookups(StaticDecoder<8>(), random, ROUNDS, false, checksum); break;
+        case 16: t_static = time_lookups(StaticDecoder<16>(), random, ROUNDS, false, checksum); break;
+        case 32: t_static = time_lookups(StaticDecoder<32>(), random, ROUNDS, false, checksum); break;
+        case 64: t_static = time_lookups(StaticDecoder<64>(), random, ROUNDS, false, checksum); break;
+        case 128: t_static = time_lookups(StaticDecoder<128>(), random, ROUNDS, false, checksum); break;
+        case 256: t_static = time_lookups(StaticDecoder<256>(), random, ROUNDS, false, checksum); break;
+        }
+        cout << n << ", " << fixed << setprecision(2) << t_streaming << ", " << t_random
+             << ", " << t_static << endl;
+    }
+    cout << "checksum: " << checksum << endl;
+    return 0;
+}
@@ -0,0 +1,260 @@
+#include <iostream>
+#include <systemc>
+#include <tlm.h>
+#include "tlm_utils/peq_with_get.h"
+#include "tlms/tlm_router/tlm_router.hpp"
+#include "tlms/commons/memory.h"
+#include "commons/assertions.hpp"
+
+using namespace std;
+
+/**
+ * Pool of generic payloads, as required by the AT base protocol
+ */
+struct PayloadPool: tlm::tlm_mm_interface
+{
+    std::vector<tlm::tlm_generic_payload*> all;
+    std::vector<tlm::tlm_generic_payload*> free_list;
+
+    tlm::tlm_generic_payload* allocate() {
+        if (free_list.empty()) {
+            all.push_back(new tlm::tlm_generic_payload(this));
+            return all.back();
+        }
+        tlm::tlm_generic_payload* trans = free_list.back();
+        free_list.pop_back();
+        return trans;
+    }
+
+    void free(tlm::tlm_generic_payload* trans) {
+        trans->reset();
+        free_list.push_back(trans);
+    }
+
+    ~PayloadPool() {
+        for (auto trans : all)
+            delete trans;
+    }
+};
+
+/**
+ * AT initiator issuing a list of word accesses back to back.
+ * A new request is issued as soon as the previous one has been accepted (END_REQ),
+ * without waiting for its response.
+ */
+struct ATInitiator: sc_module
+{
+    tlm_utils::simple_initiator_socket<ATInitiator> socket;
+
+    struct Request {
+        tlm::tlm_command cmd;
+        uint64_t addr;
+        uint32_t data;
+    };
+    std::vector<Request> requests;
+
+    PayloadPool pool;
+    sc_event end_req_event;
+    tlm::tlm_generic_payload* waiting_end_req {nullptr};
+    int outstanding {0};
+    int max_outstanding {0};
+    int completed {0};
+    int errors {0};
+
+    SC_CTOR(ATInitiator) : socket("socket")
+    {
+        socket.register_nb_transport_bw(this, &ATInitiator::nb_transport_bw);
+        SC_THREAD(run);
+    }
+
+    void run() {
+        for (auto& request : requests) {
+            tlm::tlm_generic_payload* trans = pool.allocate();
+            trans->acquire();
+            trans->set_command( request.cmd );
+            trans->set_address( request.addr );
+            trans->set_data_ptr( reinterpret_cast<unsigned char*>(&request.data) );
+            trans->set_data_length( 4 );
+            trans->set_streaming_width( 4 );
+            trans->set_byte_enable_ptr( 0 );
+            trans->set_response_status( tlm::TLM_INCOMPLETE_RESPONSE );
+
+            tlm::tlm_phase phase = tlm::BEGIN_REQ;
+            sc_time delay = SC_ZERO_TIME;
+            outstanding++;
+            max_outstanding = std::max(max_outstanding, outstanding);
+            waiting_end_req = trans;
+            tlm::tlm_sync_enum status = socket->nb_transport_fw( *trans, phase, delay );
+            if (status == tlm::TLM_ACCEPTED) {
+                wait(end_req_event);
+            } else if (status == tlm::TLM_UPDATED) {
+                waiting_end_req = nullptr;
+                wait(delay);
+            } else {
+                waiting_end_req = nullptr;
+                response_received(*trans);
+            }
+        }
+    }
+
+    void response_received(tlm::tlm_generic_payload& trans) {
+        if (trans.is_response_error())
+            errors++;
+        outstanding--;
+        completed++;
+        trans.release();
+    }
+
+    tlm::tlm_sync_enum nb_transport_bw(tlm::tlm_generic_payload& trans, tlm::tlm_phase& phase, sc_time& delay) {
+        if (waiting_end_req == &trans && (phase == tlm::END_REQ || phase == tlm::BEGIN_RESP)) {
+            waiting_end_req = nullptr;
+            end_req_event.notify(delay);
+        }
+        if (phase == tlm::BEGIN_RESP) {
+            response_received(trans);
+            phase = tlm::END_RESP;
+            return tlm::TLM_COMPLETED;
+        }
+        return tlm::TLM_ACCEPTED;
+    }
+};
+
+/**
+ * AT target ending requests after accept_delay and responding LATENCY later.
+ */
+template <unsigned int SIZE>
+struct ATMemory: sc_module
+{
+    tlm_utils::simple_target_socket<ATMemory> socket;
+    tlm_utils::peq_with_get<tlm::tlm_generic_payload> peq;
+    const sc_time LATENCY;
+    // Time the request phase ends after BEGIN_REQ
+    sc_time accept_delay;
+    sc_event end_resp_event;
+    bool response_in_progress {false};
+    uint32_t mem[SIZE];
+
+    SC_CTOR(ATMemory) : socket("socket"), peq("peq"), LATENCY(10, SC_NS)
+    {
+        socket.register_nb_transport_fw(this, &ATMemory::nb_transport_fw);
+        SC_THREAD(respond);
+    }
+
+    tlm::tlm_sync_enum nb_transport_fw(tlm::tlm_generic_payload& trans, tlm::tlm_phase& phase, sc_time& delay) {
+        if (phase == tlm::BEGIN_REQ) {
+            delay += accept_delay;
+            peq.notify(trans, delay + LATENCY);
+            phase = tlm::END_REQ;
+            return tlm::TLM_UPDATED;
+        }
+        if (phase == tlm::END_RESP) {
+            response_in_progress = false;
+            end_resp_event.notify(delay);
+        }
+        return tlm::TLM_COMPLETED;
+    }
+
+    void respond() {
+        while (true) {
+            wait(peq.get_event());
+            tlm::tlm_generic_payload* trans;
+            while ((trans = peq.get_next_transaction())) {
+                if (response_in_progress)
+                    wait(end_resp_event);
+                uint64_t adr = trans->get_address() / 4;
+                if (trans->get_command() == tlm::TLM_WRITE_COMMAND)
+                    memcpy(&mem[adr], trans->get_data_ptr(), 4);
+                else
+                    memcpy(trans->get_data_ptr(), &mem[adr], 4);
+                trans->set_response_status( tlm::TLM_OK_RESPONSE );
+                tlm::tlm_phase phase = tlm::BEGIN_RESP;
+                sc_time delay = SC_ZERO_TIME;
+                tlm::tlm_sync_enum status = socket->nb_transport_bw(*trans, phase, delay);
+                response_in_progress = !(status == tlm::TLM_COMPLETED ||
+                                         (status == tlm::TLM_UPDATED && phase == tlm::END_RESP));
+            }
+        }
+    }
+};
+
+int sc_main(int argc, char** argv) {
+
+    ATInitiator init1 = ATInitiator("init1");
+    ATInitiator init2 = ATInitiator("init2");
+    ATMemory<0x100> mem1 = ATMemory<0x100>("memory1");
+    Memory<0x100> mem2 = Memory<0x100>("memory2");
+
+    TLMRouter<2, 2> router = TLMRouter<2, 2>("router", "/workdir/build/tlm_router_at.csv");
+    init1.socket.bind(*(router.target_socket[0]));
+    init2.socket.bind(*(router.target_socket[1]));
+
+    const InitiatorConfig mem1Config = {0x0, 0x400, 0x3FF};
+    router.setInitiatorProperties(0, mem1Config);
+    router.initiator_socket[0]->bind(mem1.socket);
+
+    const InitiatorConfig mem2Config = {0x1000, 0x1400, 0x3FF};
+    router.setInitiatorProperties(1, mem2Config);
+    router.initiator_socket[1]->bind(mem2.socket);
+
+    ATInitiator init3 = ATInitiator("init3");
+    ATInitiator init4 = ATInitiator("init4");
+    ATInitiator init5 = ATInitiator("init5");
+    ATMemory<0x100> mem3 = ATMemory<0x100>("memory3");
+    ATMemory<0x100> mem4 = ATMemory<0x100>("memory4");
+    mem3.accept_delay = sc_time(10, SC_NS);
+    mem4.accept_delay = sc_time(20, SC_NS);
+
+    TLMRouter<3, 2> router2 = TLMRouter<3, 2>("router2", "/workdir/build/tlm_router_at2.csv");
+    init3.socket.bind(*(router2.target_socket[0]));
+    init4.socket.bind(*(router2.target_socket[1]));
+    init5.socket.bind(*(router2.target_socket[2]));
+    router2.setInitiatorProperties(0, mem1Config);
+    router2.initiator_socket[0]->bind(mem3.socket);
+    router2.setInitiatorProperties(1, mem2Config);
+    router2.initiator_socket[1]->bind(mem4.socket);
+
+    // One request each: no later traffic can wake the arbiter up
+    init3.requests.push_back({tlm::TLM_WRITE_COMMAND, 0x0, 0x500});
+    init4.requests.push_back({tlm::TLM_WRITE_COMMAND, 0x1000, 0x600});
+    init5.requests.push_back({tlm::TLM_WRITE_COMMAND, 0x1004, 0x700});
+
+    // Both initiators write to both memories (contending for them), then read back
+    const int NACCESSES = 16;
+    for (int i = 0; i < NACCESSES; i++) {
+        init1.requests.push_back({tlm::TLM_WRITE_COMMAND, (uint64_t)i * 8, (uint32_t)(0x100 + i)});
+        init1.requests.push_back({tlm::TLM_WRITE_COMMAND, 0x1000 + (uint64_t)i * 8, (uint32_t)(0x200 + i)});
+        init2.requests.push_back({tlm::TLM_WRITE_COMMAND, (uint64_t)i * 8 + 4, (uint32_t)(0x300 + i)});
+        init2.requests.push_back({tlm::TLM_WRITE_COMMAND, 0x1004 + (uint64_t)i * 8, (uint32_t)(0x400 + i)});
+    }
+    for (int i = 0; i < NACCESSES; i++) {
+        init1.requests.push_back({tlm::TLM_READ_COMMAND, (uint64_t)i * 8, 0});
+        init2.requests.push_back({tlm::TLM_READ_COMMAND, 0x1004 + (uint64_t)i * 8, 0});
+    }
+    // Unmapped: completed by the router with an address error
+    init2.requests.push_back({tlm::TLM_READ_COMMAND, 0x2000, 0});
+
+    sc_start(10, SC_US);
+
+    checkValuesMatch<int>(init1.completed, (int)init1.requests.size(), "init1_completed");
+    checkValuesMatch<int>(init2.completed, (int)init2.requests.size(), "init2_completed");
+    checkValuesMatch<int>(init1.errors, 0, "init1_errors");
+    checkValuesMatch<int>(init2.errors, 1, "init2_unmapped");
+    for (int i = 0; i < NACCESSES; i++) {
+        checkValuesMatch<uint32_t>(mem1.mem[2*i], 0x100 + i, "mem1_init1");
+        checkValuesMatch<uint32_t>(mem1.mem[2*i+1], 0x300 + i, "mem1_init2");
+        checkValuesMatch<uint32_t>(mem2.mem[2*i], 0x200 + i, "mem2_init1");
+        checkValuesMatch<uint32_t>(mem2.mem[2*i+1], 0x400 + i, "mem2_init2");
+        checkValuesMatch<uint32_t>(init1.requests[2*NACCESSES + i].data, 0x100 + i, "init1_readback");
+        checkValuesMatch<uint32_t>(init2.requests[2*NACCESSES + i].data, 0x400 + i, "init2_readback");
+    }
+    // ATMemory accepts requests early: responses must have been pipelined
+    checkValuesDifferentFrom<int>(init1.max_outstanding, 1, "pipelining");
+
+    // The two memories behind router2 end their first requests at
+    // different times; the request queued behind the later one must still go
+    checkValuesMatch<int>(init3.completed, 1, "init3_completed");
+    checkValuesMatch<int>(init4.completed, 1, "init4_completed");
+    checkValuesMatch<int>(init5.completed, 1, "init5_queued_completed");
+    checkValuesMatch<uint32_t>(mem4.mem[1], 0x700, "mem4_queued");
+    return 0;
+}
@@ -39,6 +39,32 @@ void test_out_of_bound_error(Initiator& init){
     checkValuesMatch<bool>(ex_triggered, true, "out-of-bound-detection");
 }
 
+void test_overlapping_regions(){
+    AddressDecoder decoder;
+    decoder.add(0, {0x0, 0x1000, 0xFFF});
+    decoder.add(1, {0x2000, 0x3000, 0xFFF});
+    decoder.add(2, {0x0FFC, 0x2000, 0xFFF});
+    bool ex_triggered = false;
+    try {
+        decoder.build();
+    } catch (const sc_core::sc_report& ex){
+        ex_triggered = true;
+    }
+    checkValuesMatch<bool>(ex_triggered, true, "overlap-detection");
+}
+
+void test_decode_64bit(){
+    AddressDecoder decoder;
+    decoder.add(0, {0x100000000, 0x100001000, 0xFFF});
+    decoder.add(1, {0x0, 0x1000, 0xFFF});
+    decoder.build();
+    const AddressDecoder::Region* hint = nullptr;
+    checkValuesMatch<unsigned int>(decoder.find(0x100000010, hint)->index, 0, "decode-high");
+    checkValuesMatch<bool>(hint != nullptr, true, "decode-hint");
+    checkValuesMatch<unsigned int>(decoder.find(0x10, hint)->index, 1, "decode-low");
+    checkValuesMatch<bool>(decoder.find(0x100001000) == nullptr, true, "decode-miss");
+}
+
 int sc_main(int argc, char** argv) {
 
     sc_trace_file *Tf = sc_create_vcd_trace_file("/workdir/trace_tlm_basic_routing");
@@ -66,6 +92,8 @@ int sc_main(int argc, char** argv) {
     try {
         test_simple_access(init1, mem, NACCESSES);
         test_out_of_bound_error(init1);
+        test_overlapping_regions();
+        test_decode_64bit();
     } catch (const std::exception& ex) {
         sc_close_vcd_trace_file(Tf);
         SC_REPORT_ERROR("TEST_FAILURE", ex.what());
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <fstream>
+#include <systemc>
+#include <tlm.h>
+#include "tlms/tlm_router/tlm_router.hpp"
+#include "tlms/tlm_memories/tlm_rom.hpp"
+#include "tlms/commons/memory.h"
+#include "tlms/commons/initiator.h"
+#include "commons/assertions.hpp"
+
+using namespace std;
+
+unsigned int _debug_access(Initiator& init, tlm::tlm_command cmd, uint64_t addr, unsigned char* data, unsigned int len) {
+    tlm::tlm_generic_payload trans;
+    trans.set_command( cmd );
+    trans.set_address( addr );
+    trans.set_data_ptr( data );
+    trans.set_data_length( len );
+    return init.socket->transport_dbg( trans );
+}
+
+void test_spanning_write(Initiator& init, Memory<0x100>& mem1, Memory<0x100>& mem2) {
+    // 0x200 bytes at the top of mem1 and 0x100 at the bottom of mem2
+    std::vector<unsigned char> data(0x300);
+    for (unsigned int i = 0; i < data.size(); i++)
+        data[i] = i & 0xFF;
+    unsigned int copied = _debug_access(init, tlm::TLM_WRITE_COMMAND, 0x200, data.data(), data.size());
+    checkValuesMatch<unsigned int>(copied, 0x300, "spanning_write_len");
+
+    const unsigned char* m1 = reinterpret_cast<const unsigned char*>(mem1.mem);
+    const unsigned char* m2 = reinterpret_cast<const unsigned char*>(mem2.mem);
+    checkValuesMatch<unsigned int>(m1[0x200], 0x00, "mem1_first");
+    checkValuesMatch<unsigned int>(m1[0x3FF], 0xFF, "mem1_last");
+    checkValuesMatch<unsigned int>(m2[0x000], 0x00, "mem2_first");
+    checkValuesMatch<unsigned int>(m2[0x0FF], 0xFF, "mem2_last");
+
+    // Nothing should go through the timed path
+    checkValuesMatch<long int>(mem1.wr_ops, 0, "mem1_wr_ops");
+    checkValuesMatch<long int>(mem2.wr_ops, 0, "mem2_wr_ops");
+}
+
+void test_spanning_read(Initiator& init) {
+    std::vector<unsigned char> data(0x300, 0);
+    unsigned int copied = _debug_access(init, tlm::TLM_READ_COMMAND, 0x200, data.data(), data.size());
+    checkValuesMatch<unsigned int>(copied, 0x300, "spanning_read_len");
+    for (unsigned int i = 0; i < data.size(); i++)
+        checkValuesMatch<unsigned int>(data[i], i & 0xFF, "spanning_read_data");
+}
+
+void test_rom_read(Initiator& init, const std::string& img_file) {
+    std::ifstream in(img_file, std::ios::binary);
+    std::vector<unsigned char> expected((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    // Starting 0x10 bytes before the ROM and reading past its end:
+    // the transfer stops at the last byte of the image.
+    std::vector<unsigned char> data(0x10 + expected.size() + 0x20, 0);
+    unsigned int copied = _debug_access(init, tlm::TLM_READ_COMMAND, 0x7F0, data.data(), data.size());
+    checkValuesMatch<unsigned int>(copied, 0x10 + expected.size(), "rom_read_len");
+    std::vector<unsigned char> rom(data.begin() + 0x10, data.begin() + 0x10 + expected.size());
+    checkValuesMatch<unsigned char>(rom, expected, "rom_read_data");
+}
+
+void test_unmapped(Initiator& init) {
+    unsigned char data[4];
+    unsigned int copied = _debug_access(init, tlm::TLM_READ_COMMAND, 0x10000, data, 4);
+    checkValuesMatch<unsigned int>(copied, 0, "unmapped_read_len");
+}
+
+int sc_main(int argc, char** argv) {
+
+    std::string img_file =
+        std::string("/workdir/models/memories/tests/image_for_storage.img");
+
+    Initiator init = Initiator("init");
+    Memory<0x100> mem1 = Memory<0x100>("memory1");
+    Memory<0x100> mem2 = Memory<0x100>("memory2");
+    TLM_ROM rom = TLM_ROM("rom", 0x0, img_file.c_str());
+
+    TLMRouter<1, 3> router = TLMRouter<1, 3>("router", "/workdir/build/tlm_router_dbg.csv");
+    init.socket.bind(*(router.target_socket[0]));
+
+    const InitiatorConfig mem1Config = {0x0, 0x400, 0x3FF};
+    router.setInitiatorProperties(0, mem1Config);
+    router.initiator_socket[0]->bind(mem1.socket);
+
+    const InitiatorConfig mem2Config = {0x400, 0x800, 0x3FF};
+    router.setInitiatorProperties(1, mem2Config);
+    router.initiator_socket[1]->bind(mem2.socket);
+
+    const InitiatorConfig romConfig = {0x800, 0x1000, 0x7FF};
+    router.setInitiatorProperties(2, romConfig);
+    router.initiator_socket[2]->bind(rom.dataBus);
+
+    sc_start(SC_ZERO_TIME);
+
+    test_spanning_write(init, mem1, mem2);
+    test_spanning_read(init);
+    test_rom_read(init, img_file);
+    test_unmapped(init);
+
+    // Debug accesses do not consume simulated time
+    checkValuesMatch<bool>(sc_time_stamp() == SC_ZERO_TIME, true, "zero_time");
+    return 0;
+}
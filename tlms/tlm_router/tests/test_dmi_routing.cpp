@@ -0,0 +1,140 @@
+#include <iostream>
+#include <systemc>
+#include <tlm.h>
+#include "tlms/tlm_router/tlm_router.hpp"
+#include "tlms/commons/memory.h"
+#include "tlms/commons/initiator.h"
+#include "commons/assertions.hpp"
+
+using namespace std;
+
+/**
+ * Initiator keeping track of the DMI invalidations it receives
+ */
+struct DmiInitiator: sc_module
+{
+    tlm_utils::simple_initiator_socket<DmiInitiator> socket;
+
+    sc_dt::uint64 invalidated_start {0};
+    sc_dt::uint64 invalidated_end {0};
+    int invalidations {0};
+
+    SC_CTOR(DmiInitiator) : socket("socket")
+    {
+        socket.register_invalidate_direct_mem_ptr(this, &DmiInitiator::invalidate_direct_mem_ptr);
+    }
+
+    bool get_dmi(sc_dt::uint64 address, tlm::tlm_dmi& dmi_data) {
+        tlm::tlm_generic_payload trans;
+        trans.set_command( tlm::TLM_READ_COMMAND );
+        trans.set_address( address );
+        return socket->get_direct_mem_ptr( trans, dmi_data );
+    }
+
+    void invalidate_direct_mem_ptr(sc_dt::uint64 start_range, sc_dt::uint64 end_range) {
+        invalidated_start = start_range;
+        invalidated_end = end_range;
+        invalidations++;
+    }
+};
+
+/**
+ * Memory that can revoke the DMI pointers it has handed out
+ */
+template <unsigned int SIZE>
+struct RevokingMemory: Memory<SIZE>
+{
+    explicit RevokingMemory(sc_module_name name) : Memory<SIZE>(name) {}
+
+    void revoke(sc_dt::uint64 start_range, sc_dt::uint64 end_range) {
+        this->socket->invalidate_direct_mem_ptr(start_range, end_range);
+    }
+};
+
+void test_dmi_translation(DmiInitiator& init, Memory<0x100>& mem) {
+    tlm::tlm_dmi dmi_data;
+    bool granted = init.get_dmi(0x1004, dmi_data);
+    checkValuesMatch<bool>(granted, true, "dmi_granted");
+    // Region [0x1000, 0x1100) is masked with 0xEFFF onto [0x0, 0x100)
+    checkValuesMatch<sc_dt::uint64>(dmi_data.get_start_address(), 0x1000, "dmi_start");
+    checkValuesMatch<sc_dt::uint64>(dmi_data.get_end_address(), 0x10FF, "dmi_end");
+    checkValuesMatch<bool>(dmi_data.get_dmi_ptr() == reinterpret_cast<unsigned char*>(&mem.mem[0]),
+                           true, "dmi_ptr");
+}
+
+void test_dmi_offset(DmiInitiator& init, Memory<0x100>& mem) {
+    tlm::tlm_dmi dmi_data;
+    // Region [0x20010, 0x20100) is masked with 0xFFFF onto [0x10, 0x100)
+    bool granted = init.get_dmi(0x20020, dmi_data);
+    checkValuesMatch<bool>(granted, true, "dmi_granted");
+    checkValuesMatch<sc_dt::uint64>(dmi_data.get_start_address(), 0x20010, "dmi_start");
+    checkValuesMatch<sc_dt::uint64>(dmi_data.get_end_address(), 0x200FF, "dmi_end");
+    checkValuesMatch<bool>(dmi_data.get_dmi_ptr() == reinterpret_cast<unsigned char*>(&mem.mem[0]) + 0x10,
+                           true, "dmi_ptr");
+}
+
+void test_dmi_coherency(DmiInitiator& dmi_init, Initiator& init) {
+    tlm::tlm_dmi dmi_data;
+    dmi_init.get_dmi(0x1000, dmi_data);
+    uint32_t value = 0xCAFEBABE;
+    memcpy(dmi_data.get_dmi_ptr() + 8, &value, 4);
+    value = 0;
+    _initiator_doread(init, &value, 0x1008);
+    checkValuesMatch<uint32_t>(value, 0xCAFEBABE, "dmi_write_then_read");
+
+    value = 0x12345678;
+    _initiator_dowrite(init, &value, 0x100C);
+    memcpy(&value, dmi_data.get_dmi_ptr() + 0xC, 4);
+    checkValuesMatch<uint32_t>(value, 0x12345678, "write_then_dmi_read");
+}
+
+void test_dmi_invalidation(DmiInitiator& init, RevokingMemory<0x100>& mem) {
+    mem.revoke(0x10, 0x1F);
+    checkValuesMatch<int>(init.invalidations, 1, "invalidation_count");
+    checkValuesMatch<sc_dt::uint64>(init.invalidated_start, 0x1010, "invalidated_start");
+    checkValuesMatch<sc_dt::uint64>(init.invalidated_end, 0x101F, "invalidated_end");
+
+    mem.revoke(0x0, (sc_dt::uint64)-1);
+    checkValuesMatch<int>(init.invalidations, 2, "invalidation_count");
+    checkValuesMatch<sc_dt::uint64>(init.invalidated_start, 0x1000, "invalidated_start");
+    checkValuesMatch<sc_dt::uint64>(init.invalidated_end, 0x10FF, "invalidated_end");
+}
+
+void test_dmi_unmapped(DmiInitiator& init) {
+    // Refused, not reported as an error
+    tlm::tlm_dmi dmi_data;
+    bool granted = init.get_dmi(0x30000, dmi_data);
+    checkValuesMatch<bool>(granted, false, "dmi_unmapped");
+}
+
+int sc_main(int argc, char** argv) {
+
+    DmiInitiator dmi_init = DmiInitiator("dmi_init");
+    Initiator init = Initiator("init");
+
+    RevokingMemory<0x100> mem1 = RevokingMemory<0x100>("memory1");
+    Memory<0x100> mem2 = Memory<0x100>("memory2");
+
+    TLMRouter<2, 2> router = TLMRouter<2, 2>("router", "/workdir/build/tlm_router_dmi.csv");
+
+    dmi_init.socket.bind(*(router.target_socket[0]));
+    init.socket.bind(*(router.target_socket[1]));
+
+    const InitiatorConfig mem1Config = {0x1000, 0x1100, 0xEFFF};
+    router.setInitiatorProperties(0, mem1Config);
+    router.initiator_socket[0]->bind(mem1.socket);
+
+    const InitiatorConfig mem2Config = {0x20010, 0x20100, 0xFFFF};
+    router.setInitiatorProperties(1, mem2Config);
+    router.initiator_socket[1]->bind(mem2.socket);
+
+    sc_start(SC_ZERO_TIME);
+
+    test_dmi_translation(dmi_init, mem1);
+    test_dmi_offset(dmi_init, mem2);
+    test_dmi_coherency(dmi_init, init);
+    test_dmi_invalidation(dmi_init, mem1);
+    test_dmi_unmapped(dmi_init);
+
+    return 0;
+}
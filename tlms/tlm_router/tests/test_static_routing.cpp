@@ -0,0 +1,101 @@
+#include <iostream>
+#include <random>
+#include <systemc>
+#include <tlm.h>
+#include "tlms/tlm_router/tlm_router.hpp"
+#include "tlms/commons/memory.h"
+#include "tlms/commons/initiator.h"
+#include "commons/assertions.hpp"
+
+using namespace std;
+
+// Same map as test_multiport, listed out of order on purpose
+typedef MappedRegion<0x10000, 0x10100, 0xEFFFF> Mem3Region;
+typedef MappedRegion<0x0, 0x100, 0xFFF> Mem1Region;
+typedef MappedRegion<0x1000, 0x1100, 0xEFFF> Mem2Region;
+typedef StaticTLMRouter<2, Mem1Region, Mem2Region, Mem3Region> Router;
+
+void test_decoder_matches_runtime(){
+    StaticAddressDecoder<Mem3Region, Mem1Region, Mem2Region> fixed;
+    AddressDecoder runtime;
+    runtime.add(0, {0x10000, 0x10100, 0xEFFFF});
+    runtime.add(1, {0x0, 0x100, 0xFFF});
+    runtime.add(2, {0x1000, 0x1100, 0xEFFF});
+    runtime.build();
+
+    mt19937_64 rng(0x57A71C);
+    for (int i=0; i<10000; i++) {
+        uint64_t address = rng() % 0x11000;
+        const AddressDecoder::Region* a = fixed.find(address);
+        const AddressDecoder::Region* b = runtime.find(address);
+        checkValuesMatch<bool>(a == nullptr, b == nullptr, "static-decode-hit");
+        if (a)
+            checkValuesMatch<unsigned int>(a->index, b->index, "static-decode-index");
+    }
+    checkValuesMatch<uint64_t>(0xEFFF, Router::DECODER_TYPE::config(1).mask, "static-config");
+}
+
+void test_static_map_is_fixed(Router& router){
+    bool ex_triggered = false;
+    try {
+        router.setInitiatorProperties(0, {0x0, 0x1000, 0xFFF});
+    } catch (const sc_core::sc_report& ex){
+        ex_triggered = true;
+    }
+    checkValuesMatch<bool>(ex_triggered, true, "static-map-fixed");
+}
+
+int sc_main(int argc, char** argv) {
+
+  Initiator init1 = Initiator("init1");
+  Initiator init2 = Initiator("init2");
+
+  Memory<0x100> mem1 = Memory<0x100>("memory1");
+  Memory<0x100> mem2 = Memory<0x100>("memory2");
+  Memory<0x100> mem3 = Memory<0x100>("memory3");
+
+  Router router = Router("router", "/workdir/build/tlm_router_static.csv");
+
+  init1.socket.bind(*(router.target_socket[0]));
+  init2.socket.bind(*(router.target_socket[1]));
+  router.initiator_socket[0]->bind(mem1.socket);
+  router.initiator_socket[1]->bind(mem2.socket);
+  router.initiator_socket[2]->bind(mem3.socket);
+
+  const int NACCESSES = 10;
+
+  uint32_t data1, data2, data3;
+
+  try {
+    test_decoder_matches_runtime();
+
+    for (int i=0; i<NACCESSES; i++) {
+        data1 = i;
+        data2 = i+0x1000;
+        data3 = i+0x10000;
+        _initiator_dowrite(init1, &data1, i*4);
+        _initiator_dowrite(init2, &data2, i*4+0x1000);
+        _initiator_dowrite(init2, &data3, i*4+0x10000);
+    }
+    for (int i=0; i<NACCESSES; i++) {
+        _initiator_doread(init1, &data1, i*4+0x10000);
+        _initiator_doread(init2, &data2, i*4+0x1000);
+        _initiator_doread(init1, &data3, i*4);
+        checkValuesMatch<int32_t>(i+0x10000, data1, "readback1");
+        checkValuesMatch<int32_t>(i+0x1000, data2, "readback2");
+        checkValuesMatch<int32_t>(i, data3, "readback3");
+    }
+
+    checkValuesMatch<long int>(NACCESSES, mem1.wr_ops, "mem1_wr");
+    checkValuesMatch<long int>(NACCESSES, mem1.rd_ops, "mem1_rd");
+    checkValuesMatch<long int>(NACCESSES, mem2.wr_ops, "mem2_wr");
+    checkValuesMatch<long int>(NACCESSES, mem2.rd_ops, "mem2_rd");
+    checkValuesMatch<long int>(NACCESSES, mem3.wr_ops, "mem3_wr");
+    checkValuesMatch<long int>(NACCESSES, mem3.rd_ops, "mem3_rd");
+
+    test_static_map_is_fixed(router);
+  } catch (const std::exception& ex) {
+    SC_REPORT_ERROR("TEST_FAILURE", ex.what());
+  }
+  return 0;
+}
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <systemc>
+#include <tlm.h>
+#include "tlms/tlm_router/tlm_router.hpp"
+#include "tlms/commons/memory.h"
+#include "tlms/commons/initiator.h"
+#include "commons/assertions.hpp"
+
+using namespace std;
+
+const char* STATS_FILE = "/workdir/build/tlm_router_stats.csv";
+
+void test_route_counters(Initiator& init1, Initiator& init2, TLMRouter<2, 2>& router,
+                         const long int naccesses){
+    uint32_t value = 0;
+    for (int i=0; i<naccesses; i++) {
+        _initiator_dowrite(init1, &value, i*4);
+        _initiator_dowrite(init2, &value, 0x1000 + i*4);
+    }
+    // snapshot before the reads
+    TLMRouter<2, 2>::RouteStatsType::Snapshot before = router.route_stats.snapshot();
+    for (int i=0; i<naccesses; i++)
+        _initiator_doread(init1, &value, 0x1000 + i*4);
+
+    const RouteCounters& c00 = router.route_stats.get(0, 0);
+    const RouteCounters& c11 = router.route_stats.get(1, 1);
+    const RouteCounters& c01 = router.route_stats.get(0, 1);
+    checkValuesMatch<uint64_t>(naccesses, c00.writes, "stats-writes-00");
+    checkValuesMatch<uint64_t>(0, c00.reads, "stats-reads-00");
+    checkValuesMatch<uint64_t>(4*naccesses, c00.write_bytes, "stats-bytes-00");
+    checkValuesMatch<uint64_t>(naccesses, c11.transactions(), "stats-count-11");
+    checkValuesMatch<uint64_t>(naccesses, c01.reads, "stats-reads-01");
+    checkValuesMatch<uint64_t>(4*naccesses, c01.read_bytes, "stats-read-bytes-01");
+    checkValuesMatch<uint64_t>(0, router.route_stats.get(1, 0).transactions(), "stats-count-10");
+    checkValuesMatch<uint64_t>(0, before[0][1].reads, "stats-snapshot");
+
+    // Memory annotates a 10 ns latency on every access
+    unsigned int bucket = RouteCounters::delay_bucket(sc_time(10, SC_NS).value());
+    checkValuesMatch<uint64_t>(naccesses, c00.delay_histogram[bucket], "stats-delay-bucket");
+    checkValuesMatch<uint64_t>(0, c00.delay_histogram[0], "stats-delay-zero");
+
+    router.route_stats.reset();
+    checkValuesMatch<uint64_t>(0, router.route_stats.get(0, 0).transactions(), "stats-reset");
+}
+
+void test_stats_dump(Initiator& init1, TLMRouter<2, 2>& router, const long int naccesses){
+    uint32_t value = 0;
+    router.enable_stats_dump(STATS_FILE, sc_time(100, SC_NS));
+    for (int i=0; i<naccesses; i++)
+        _initiator_dowrite(init1, &value, i*4);
+    // each access takes 21 ns
+    sc_start(100, SC_NS);
+    // Nothing is scheduled once the router is idle: an unbounded run ends
+    sc_start();
+    router.stats_file.close();
+
+    ifstream in(STATS_FILE);
+    string line;
+    int dumps = 0;
+    int routes = 0;
+    while (getline(in, line)) {
+        if (line[0] == '#')
+            dumps++;
+        else if (line.find("Target") != 0)
+            routes++;
+    }
+    // One dump per period holding traffic, none once the router is idle
+    checkValuesMatch<int>(21*(naccesses - 1)/100 + 1, dumps, "stats-dumps");
+    checkValuesMatch<bool>(routes > 0, true, "stats-dump-routes");
+
+    bool rejected = false;
+    try {
+        router.enable_stats_dump(STATS_FILE, SC_ZERO_TIME);
+    } catch (const sc_core::sc_report& ex) {
+        rejected = true;
+    }
+    checkValuesMatch<bool>(rejected, true, "stats-zero-period");
+}
+
+int sc_main(int argc, char** argv) {
+
+    Initiator init1 = Initiator("init1");
+    Initiator init2 = Initiator("init2");
+    Memory<0x100> mem1 = Memory<0x100>("memory1");
+    Memory<0x100> mem2 = Memory<0x100>("memory2");
+
+    TLMRouter<2, 2> router = TLMRouter<2, 2>("router", "/workdir/build/tlm_router_stats_trace.csv");
+
+    init1.socket.bind(*(router.target_socket[0]));
+    init2.socket.bind(*(router.target_socket[1]));
+    router.initiator_socket[0]->bind(mem1.socket);
+    router.initiator_socket[1]->bind(mem2.socket);
+    router.setInitiatorProperties(0, {0x0, 0x1000, 0xFFF});
+    router.setInitiatorProperties(1, {0x1000, 0x2000, 0xFFF});
+
+    const long int NACCESSES = 10;
+
+    try {
+        test_route_counters(init1, init2, router, NACCESSES);
+        test_stats_dump(init1, router, NACCESSES);
+    } catch (const std::exception& ex) {
+        SC_REPORT_ERROR("TEST_FAILURE", ex.what());
+    }
+    return 0;
+}
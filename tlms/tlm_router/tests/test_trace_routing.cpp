@@ -0,0 +1,141 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <systemc>
+#include <tlm.h>
+#include "tlms/tlm_router/tlm_router.hpp"
+#include "tlms/commons/memory.h"
+#include "tlms/commons/initiator.h"
+#include "commons/assertions.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+const char* TRACE_FILE = "/workdir/build/tlm_router_trace.bin";
+
+vector<TraceRecord> read_trace(const char* filename){
+    ifstream in(filename, ios::binary);
+    TraceHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    checkValuesMatch<bool>(check_trace_header(header), true, "trace-header");
+    vector<TraceRecord> records;
+    TraceRecord record;
+    while (in.read(reinterpret_cast<char*>(&record), sizeof(record)))
+        records.push_back(record);
+    return records;
+}
+
+void test_binary_trace(Initiator& init, TLMRouter<1, 1>& router, const long int naccesses){
+    uint32_t value;
+    router.enable_binary_trace(TRACE_FILE, 4);
+    for (int i=0; i<naccesses; i++) {
+        value = 0x100 + i;
+        _initiator_dowrite(init, &value, 0x40 + i*4);
+    }
+    for (int i=0; i<naccesses; i++) {
+        _initiator_doread(init, &value, 0x40 + i*4);
+    }
+    router.disable_binary_trace();
+
+    vector<TraceRecord> records = read_trace(TRACE_FILE);
+    checkValuesMatch<size_t>(2*naccesses, records.size(), "trace-records");
+    for (int i=0; i<2*naccesses; i++) {
+        const TraceRecord& r = records[i];
+        bool write = i < naccesses;
+        checkValuesMatch<unsigned int>(write ? 1 : 0, r.cmd, "trace-cmd");
+        checkValuesMatch<uint64_t>(0x40 + (i % naccesses)*4, r.address, "trace-address");
+        checkValuesMatch<uint32_t>(0x100 + (i % naccesses), r.data, "trace-data");
+        checkValuesMatch<uint32_t>(4, r.len, "trace-len");
+        checkValuesMatch<uint32_t>(0, r.target, "trace-target");
+        for (unsigned int b = 0; b < sizeof(r.reserved); b++)
+            checkValuesMatch<unsigned int>(0, r.reserved[b], "trace-reserved");
+        if (i > 0)
+            checkValuesMatch<bool>(r.time_ps > records[i-1].time_ps, true, "trace-time");
+    }
+
+    // Same layout as the CSV trace, after the timestamp
+    char line[256];
+    format_trace_csv(line, sizeof(line), records[1]);
+    string csv(line);
+    checkValuesMatch<string>(",0,0,0x44,write,4,4,0x0,0x101", csv.substr(csv.find(',')), "trace-csv");
+}
+
+void test_byte_enable_trace(Initiator& init, TLMRouter<1, 1>& router){
+    // Initiator leaves the byte enable length at 0: the mask covers the data
+    uint32_t value = 0xCAFEBABE;
+    uint8_t enable [4] = {0xff, 0, 0, 0xff};
+    router.enable_binary_trace(TRACE_FILE, 4);
+    _initiator_dowrite(init, &value, 0x40, 4, 4, enable);
+    router.disable_binary_trace();
+
+    vector<TraceRecord> records = read_trace(TRACE_FILE);
+    checkValuesMatch<size_t>(1, records.size(), "trace-byte-enable-records");
+    checkValuesMatch<uint32_t>(0xFF0000FF, records[0].byte_enables, "trace-byte-enables");
+}
+
+size_t traced_accesses(Initiator& init, TLMRouter<1, 1>& router, const long int naccesses){
+    uint32_t value = 0;
+    router.enable_binary_trace(TRACE_FILE, 4);
+    for (int i=0; i<naccesses; i++) {
+        _initiator_dowrite(init, &value, 0x40 + i*4);
+        _initiator_doread(init, &value, 0x40 + i*4);
+    }
+    router.disable_binary_trace();
+    return read_trace(TRACE_FILE).size();
+}
+
+void test_trace_filters(Initiator& init, TLMRouter<1, 1>& router, const long int naccesses){
+    router.trace_filter.set_commands(false, true);
+    checkValuesMatch<size_t>(naccesses, traced_accesses(init, router, naccesses), "filter-writes");
+    router.trace_filter.reset();
+
+    router.trace_filter.add_address_window(0x40, 0x48);
+    router.trace_filter.add_address_window(0x50, 0x54);
+    checkValuesMatch<size_t>(2*3, traced_accesses(init, router, naccesses), "filter-windows");
+    router.trace_filter.reset();
+
+    router.trace_filter.set_target(0, false);
+    checkValuesMatch<size_t>(0, traced_accesses(init, router, naccesses), "filter-target");
+    router.trace_filter.reset();
+
+    router.trace_filter.set_sampling(4);
+    checkValuesMatch<size_t>(2*naccesses/4, traced_accesses(init, router, naccesses), "filter-sampling");
+    router.trace_filter.reset();
+
+    // Only the first half of the accesses fall into the time window
+    sc_time now = sc_time_stamp();
+    router.trace_filter.set_time_window(now, now + sc_time(42*naccesses/2, SC_NS));
+    checkValuesMatch<size_t>(naccesses, traced_accesses(init, router, naccesses), "filter-time");
+    router.trace_filter.reset();
+
+    router.trace_filter.set_enabled(false);
+    checkValuesMatch<size_t>(0, traced_accesses(init, router, naccesses), "filter-disabled");
+    router.trace_filter.set_enabled(true);
+    checkValuesMatch<size_t>(2*naccesses, traced_accesses(init, router, naccesses), "filter-none");
+}
+
+int sc_main(int argc, char** argv) {
+
+    Initiator init1 = Initiator("init1");
+    Memory<0x100> mem = Memory<0x100>("memory");
+
+    TLMRouter<1, 1> router = TLMRouter<1, 1>("router", "/workdir/build/tlm_router_trace.csv");
+
+    init1.socket.bind(*(router.target_socket[0]));
+    router.initiator_socket[0]->bind(mem.socket);
+
+    const InitiatorConfig memConfig = {0x0, 0x1000, 0xFFFFFFFF};
+    router.setInitiatorProperties(0, memConfig);
+
+    // running the tests
+    const long int NACCESSES = 8;
+
+    try {
+        test_binary_trace(init1, router, NACCESSES);
+        test_byte_enable_trace(init1, router);
+        test_trace_filters(init1, router, NACCESSES);
+    } catch (const std::exception& ex) {
+        SC_REPORT_ERROR("TEST_FAILURE", ex.what());
+    }
+    return 0;
+}
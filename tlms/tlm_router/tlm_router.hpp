@@ -15,21 +15,27 @@ using namespace std;
 #include "tlm.h"
 #include "tlm_utils/simple_initiator_socket.h"
 #include "tlm_utils/simple_target_socket.h"
+#include "tlm_utils/peq_with_get.h"
+#include <deque>
 #include <sstream> // std::stringstream
+#include <unordered_map>
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/rotating_file_sink.h"
-
-struct InitiatorConfig {
-    unsigned int baseAddress;
-    unsigned int topAddress;
-    unsigned int mask;
-};
+#include "tlms/tlm_router/address_decoder.hpp"
+#include "tlms/tlm_router/static_address_decoder.hpp"
+#include "tlms/tlm_router/binary_trace.hpp"
+#include "tlms/tlm_router/trace_filter.hpp"
+#include "tlms/tlm_router/route_stats.hpp"
+#include <fstream>
+#include <memory>
 
 /**
  * TLMRouter implements the router logic requires to connect multiple
- * TLM blocks
+ * TLM blocks.
+ * The memory map is set at runtime through setInitiatorProperties; see
+ * StaticTLMRouter for a map fixed at compile time.
  */
-template<unsigned int N_TARGETS, unsigned int N_INITIATORS>
+template<unsigned int N_TARGETS, unsigned int N_INITIATORS, class DECODER = AddressDecoder>
 struct TLMRouter: sc_module
 {
     // IMPORTANT NOTE:
@@ -40,6 +46,13 @@ struct TLMRouter: sc_module
 
     InitiatorConfig initiatorsConfig[N_INITIATORS];
 
+    // Decode table, rebuilt whenever the configuration changes.
+    // Each target socket remembers the last region it hit.
+    typedef DECODER DECODER_TYPE;
+    DECODER decoder;
+    const AddressDecoder::Region* last_hit[N_TARGETS];
+    bool decoder_dirty {!DECODER::is_static};
+
     void setup_logger(const char* filename) {
         auto max_size = 128*1024*1024;
         auto max_files = 3;
@@ -50,26 +63,146 @@ struct TLMRouter: sc_module
         spdlog::flush_every(std::chrono::seconds(1));
     }
 
+    // Selects which transactions are traced (all by default)
+    TraceFilter<N_TARGETS, N_INITIATORS> trace_filter;
+
+    // Binary trace: when enabled it replaces the CSV trace
+    std::unique_ptr<BinaryTraceWriter> binary_trace;
+    uint64_t trace_ps_mul {1};
+    uint64_t trace_ps_div {1};
+
+    void enable_binary_trace(const char* filename, size_t capacity = 1 << 16) {
+        double ps_per_tick = sc_get_time_resolution().to_seconds() * 1e12;
+        if (ps_per_tick >= 1.0) {
+            trace_ps_mul = static_cast<uint64_t>(ps_per_tick + 0.5);
+            trace_ps_div = 1;
+        } else {
+            trace_ps_mul = 1;
+            trace_ps_div = static_cast<uint64_t>(1.0 / ps_per_tick + 0.5);
+        }
+        binary_trace.reset(new BinaryTraceWriter(filename, capacity));
+    }
+
+    void disable_binary_trace() {
+        binary_trace.reset();
+    }
+
+    // Per-route counters, see RouteStats::snapshot and RouteStats::dump
+    // (for the AT path the delay is the time from BEGIN_REQ to BEGIN_RESP)
+    typedef RouteStats<N_TARGETS, N_INITIATORS> RouteStatsType;
+    RouteStatsType route_stats;
+
+    // Periodic dump of route_stats
+    std::ofstream stats_file;
+    sc_time stats_period;
+    sc_time stats_start;
+    sc_event stats_event;
+    // Transactions were recorded since the last dump
+    bool stats_pending {false};
+
+    /**
+     * Appends route_stats to `filename` every `period` of simulated time
+     * in which the router saw traffic (and once more at the end of the
+     * simulation). An idle router schedules nothing, so an unbounded
+     * sc_start() still ends once the traffic stops.
+     */
+    void enable_stats_dump(const char* filename, const sc_time& period) {
+        if (period == SC_ZERO_TIME) {
+            SC_REPORT_ERROR("TLM-ROUTER", "The stats dump period must be greater than zero");
+            return;
+        }
+        stats_file.close();
+        stats_file.open(filename);
+        if (!stats_file) {
+            std::string err = std::string("Cannot open stats file ") + filename;
+            SC_REPORT_ERROR("TLM-ROUTER", err.c_str());
+            return;
+        }
+        stats_period = period;
+        stats_start = sc_time_stamp();
+        stats_pending = false;
+        stats_event.cancel();
+    }
+
+    void dump_stats() {
+        if (!stats_file.is_open())
+            return;
+        route_stats.dump(stats_file);
+        stats_file.flush();
+        stats_pending = false;
+    }
+
+    void record_stats(unsigned int target_nr, unsigned int initiator_nr, const tlm::tlm_generic_payload& trans,
+                      sc_dt::uint64 delay) {
+        route_stats.record(target_nr, initiator_nr, trans.get_command(), trans.get_data_length(), delay);
+        if (stats_pending || !stats_file.is_open())
+            return;
+        // Dump at the end of the current period
+        stats_pending = true;
+        sc_dt::uint64 elapsed = (sc_time_stamp() - stats_start).value() % stats_period.value();
+        stats_event.notify(stats_period - sc_time::from_value(elapsed));
+    }
+
+    void end_of_simulation() {
+        if (stats_file.is_open())
+            route_stats.dump(stats_file);
+    }
+
     void setInitiatorProperties(int init_nr, const InitiatorConfig& config) {
+        if (DECODER::is_static)
+            SC_REPORT_ERROR("TLM-ROUTER", "The memory map of a StaticTLMRouter cannot be changed");
         initiatorsConfig[init_nr] = config;
+        decoder_dirty = true;
+    }
+
+    void build_decoder() {
+        decoder.clear();
+        for (unsigned int i = 0; i < N_INITIATORS; i++)
+            decoder.add(i, initiatorsConfig[i]);
+        decoder.build();
+        for (unsigned int i = 0; i < N_TARGETS; i++)
+            last_hit[i] = nullptr;
+        decoder_dirty = false;
+    }
+
+    void end_of_elaboration() {
+        build_decoder();
     }
 
     virtual void b_transport(int id, tlm::tlm_generic_payload& trans, sc_time& delay )
     {
         sc_dt::uint64 address = trans.get_address();
         sc_dt::uint64 masked_address = 0;
-        tlm::tlm_command cmd = trans.get_command();
-        unsigned char* ptr = trans.get_data_ptr();
-        unsigned int initiator_nr = decode_address( address, masked_address);
-        unsigned int len = trans.get_data_length();
-        unsigned int wid = trans.get_streaming_width();
-        unsigned char* byt = trans.get_byte_enable_ptr();
+        unsigned int initiator_nr = decode_address( address, masked_address, last_hit[id]);
+        if (initiator_nr == (unsigned int)-1) {
+            trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
+            return;
+        }
 
         // Modify address within transaction
         trans.set_address( masked_address );
         // Forward transaction to appropriate initiator (output bus)
+        sc_dt::uint64 delay_before = delay.value();
         ( *initiator_socket[initiator_nr] )->b_transport( trans, delay );
-        // Generating traces
+        record_stats(id, initiator_nr, trans, delay.value() - delay_before);
+        trace_transaction(id, initiator_nr, address, trans);
+    }
+
+    // Generating traces
+    inline void trace_transaction(int id, unsigned int initiator_nr, sc_dt::uint64 address,
+                                  const tlm::tlm_generic_payload& trans)
+    {
+        if (!trace_filter.accept(id, initiator_nr, address, trans.get_command()))
+            return;
+        if (binary_trace) {
+            trace_binary(id, initiator_nr, address, trans);
+            return;
+        }
+        tlm::tlm_command cmd = trans.get_command();
+        unsigned char* ptr = trans.get_data_ptr();
+        unsigned int len = trans.get_data_length();
+        unsigned int wid = trans.get_streaming_width();
+        unsigned char* byt = trans.get_byte_enable_ptr();
         uint32_t data = ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | (ptr[3] << 24);
         uint32_t enables = 0;
         if (byt)
@@ -79,22 +212,355 @@ struct TLMRouter: sc_module
                                          len, wid, enables, data);
     }
 
-    inline unsigned int decode_address( sc_dt::uint64 address, sc_dt::uint64& masked_address )
+    inline void trace_binary(int id, unsigned int initiator_nr, sc_dt::uint64 address,
+                             const tlm::tlm_generic_payload& trans)
+    {
+        const unsigned char* ptr = trans.get_data_ptr();
+        const unsigned char* byt = trans.get_byte_enable_ptr();
+        unsigned int len = trans.get_data_length();
+        unsigned int n = len < 4 ? len : 4;
+        unsigned int byt_len = trans.get_byte_enable_length();
+        if (byt && byt_len == 0)
+            byt_len = len;
+        TraceRecord record {};
+        record.time_ps = sc_time_stamp().value() * trace_ps_mul / trace_ps_div;
+        record.address = address;
+        record.target = id;
+        record.initiator = initiator_nr;
+        record.len = len;
+        record.wid = trans.get_streaming_width();
+        record.cmd = trans.get_command();
+        record.data = 0;
+        record.byte_enables = 0;
+        for (unsigned int i = 0; i < n; i++) {
+            record.data |= ptr[i] << (8 * i);
+            if (byt)
+                record.byte_enables |= byt[i % byt_len] << (8 * i);
+        }
+        binary_trace->push(record);
+    }
+
+    // ------------------------------------------------------------------------
+    // Approximately-timed path (TLM-2 base protocol, four phases).
+    // BEGIN_REQ from a target socket is decoded and queued in the request PEQ of
+    // the selected initiator socket; each initiator socket arbitrates round-robin
+    // among the target sockets and keeps at most one request in flight downstream.
+    // Responses are queued in the response PEQ of the originating target socket,
+    // which likewise keeps at most one BEGIN_RESP in flight upstream.
+    // END_REQ is forwarded upstream only once the downstream target accepted the
+    // request, so back-pressure propagates through the router.
+    // ------------------------------------------------------------------------
+
+    struct Route {
+        unsigned int target_nr;     // originating target socket
+        unsigned int initiator_nr;  // selected initiator socket
+        sc_dt::uint64 address;      // address as seen by the originating initiator
+        bool downstream_done;       // downstream hop already completed
+        sc_time start;              // time of BEGIN_REQ
+    };
+
+    // Backward path: payload to originating socket
+    std::unordered_map<tlm::tlm_generic_payload*, Route> routes;
+
+    tlm_utils::peq_with_get<tlm::tlm_generic_payload>* request_peq[N_INITIATORS];
+    tlm_utils::peq_with_get<tlm::tlm_generic_payload>* response_peq[N_TARGETS];
+
+    // Requests waiting for arbitration, per initiator socket and originating target socket
+    std::deque<tlm::tlm_generic_payload*> request_queue[N_INITIATORS][N_TARGETS];
+    std::deque<tlm::tlm_generic_payload*> response_queue[N_TARGETS];
+
+    tlm::tlm_generic_payload* request_in_progress[N_INITIATORS];
+    tlm::tlm_generic_payload* response_in_progress[N_TARGETS];
+    sc_time request_free_at[N_INITIATORS];
+    sc_time response_free_at[N_TARGETS];
+    unsigned int next_grant[N_INITIATORS];
+
+    // One per socket: a pending notification hides any later one of the same event
+    sc_event request_done_event[N_INITIATORS];
+    sc_event response_done_event[N_TARGETS];
+
+    virtual tlm::tlm_sync_enum nb_transport_fw(int id, tlm::tlm_generic_payload& trans,
+            tlm::tlm_phase& phase, sc_time& delay)
     {
-        int index = -1;
-        for (unsigned int i=0; i<N_INITIATORS; i++) {
-            if ((address >= initiatorsConfig[i].baseAddress) && (address < initiatorsConfig[i].topAddress)) {
-                masked_address = address & initiatorsConfig[i].mask;
-                index = i;
+        if (phase == tlm::BEGIN_REQ) {
+            sc_dt::uint64 address = trans.get_address();
+            const AddressDecoder::Region* region = find_region( address, last_hit[id] );
+            if (!region) {
+                trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
+                phase = tlm::BEGIN_RESP;
+                return tlm::TLM_COMPLETED;
+            }
+            if (trans.has_mm())
+                trans.acquire();
+            routes[&trans] = Route{static_cast<unsigned int>(id), region->index, address, false,
+                                   sc_time_stamp() + delay};
+            trans.set_address( address & region->mask );
+            request_peq[region->index]->notify( trans, delay );
+            return tlm::TLM_ACCEPTED;
+        }
+        if (phase == tlm::END_RESP) {
+            response_in_progress[id] = nullptr;
+            response_free_at[id] = sc_time_stamp() + delay;
+            response_done_event[id].notify( delay );
+            complete_route( trans, delay );
+            return tlm::TLM_COMPLETED;
+        }
+        SC_REPORT_ERROR("TLM-ROUTER", "TLM-ROUTER: Illegal phase received on the forward path");
+        return tlm::TLM_COMPLETED;
+    }
+
+    virtual tlm::tlm_sync_enum nb_transport_bw(int id, tlm::tlm_generic_payload& trans,
+            tlm::tlm_phase& phase, sc_time& delay)
+    {
+        Route& route = routes.at(&trans);
+        if (phase == tlm::END_REQ) {
+            request_accepted( route, trans, delay, true );
+            return tlm::TLM_ACCEPTED;
+        }
+        if (phase == tlm::BEGIN_RESP) {
+            // BEGIN_RESP implies END_REQ, which will be implied upstream as well
+            if (request_in_progress[id] == &trans)
+                request_accepted( route, trans, delay, false );
+            response_peq[route.target_nr]->notify( trans, delay );
+            return tlm::TLM_ACCEPTED;
+        }
+        SC_REPORT_ERROR("TLM-ROUTER", "TLM-ROUTER: Illegal phase received on the backward path");
+        return tlm::TLM_COMPLETED;
+    }
+
+    // The downstream target accepted the request held by its initiator socket
+    void request_accepted(const Route& route, tlm::tlm_generic_payload& trans, sc_time& delay, bool forward_end_req)
+    {
+        request_in_progress[route.initiator_nr] = nullptr;
+        request_free_at[route.initiator_nr] = sc_time_stamp() + delay;
+        request_done_event[route.initiator_nr].notify( delay );
+        if (forward_end_req) {
+            tlm::tlm_phase phase = tlm::END_REQ;
+            sc_time upstream_delay = delay;
+            ( *target_socket[route.target_nr] )->nb_transport_bw( trans, phase, upstream_delay );
+        }
+    }
+
+    // Both hops are done with the transaction
+    void complete_route(tlm::tlm_generic_payload& trans, sc_time& delay)
+    {
+        auto it = routes.find(&trans);
+        Route route = it->second;
+        routes.erase(it);
+        if (!route.downstream_done) {
+            tlm::tlm_phase phase = tlm::END_RESP;
+            sc_time downstream_delay = delay;
+            ( *initiator_socket[route.initiator_nr] )->nb_transport_fw( trans, phase, downstream_delay );
+        }
+        if (trans.has_mm())
+            trans.release();
+    }
+
+    void request_arbiter()
+    {
+        for (unsigned int i = 0; i < N_INITIATORS; i++) {
+            tlm::tlm_generic_payload* trans;
+            while ((trans = request_peq[i]->get_next_transaction()))
+                request_queue[i][routes.at(trans).target_nr].push_back(trans);
+
+            if (request_in_progress[i] || request_free_at[i] > sc_time_stamp())
+                continue;
+            // Round-robin among the target sockets
+            for (unsigned int n = 0; n < N_TARGETS; n++) {
+                unsigned int t = (next_grant[i] + n) % N_TARGETS;
+                if (request_queue[i][t].empty())
+                    continue;
+                trans = request_queue[i][t].front();
+                request_queue[i][t].pop_front();
+                next_grant[i] = (t + 1) % N_TARGETS;
+                send_request(i, *trans);
                 break;
             }
         }
-        if (index < 0) {
+    }
+
+    void send_request(unsigned int initiator_nr, tlm::tlm_generic_payload& trans)
+    {
+        Route& route = routes.at(&trans);
+        tlm::tlm_phase phase = tlm::BEGIN_REQ;
+        sc_time delay = SC_ZERO_TIME;
+        request_in_progress[initiator_nr] = &trans;
+        tlm::tlm_sync_enum status = ( *initiator_socket[initiator_nr] )->nb_transport_fw( trans, phase, delay );
+        switch (status) {
+        case tlm::TLM_ACCEPTED:
+            break;
+        case tlm::TLM_UPDATED:
+            if (phase == tlm::END_REQ) {
+                request_accepted( route, trans, delay, true );
+            } else if (phase == tlm::BEGIN_RESP) {
+                request_accepted( route, trans, delay, false );
+                response_peq[route.target_nr]->notify( trans, delay );
+            }
+            break;
+        case tlm::TLM_COMPLETED:
+            route.downstream_done = true;
+            request_accepted( route, trans, delay, false );
+            response_peq[route.target_nr]->notify( trans, delay );
+            break;
+        }
+    }
+
+    void response_arbiter()
+    {
+        for (unsigned int t = 0; t < N_TARGETS; t++) {
+            tlm::tlm_generic_payload* trans;
+            while ((trans = response_peq[t]->get_next_transaction()))
+                response_queue[t].push_back(trans);
+
+            while (!response_in_progress[t] && response_free_at[t] <= sc_time_stamp()
+                    && !response_queue[t].empty()) {
+                trans = response_queue[t].front();
+                response_queue[t].pop_front();
+                send_response(t, *trans);
+            }
+        }
+    }
+
+    void send_response(unsigned int target_nr, tlm::tlm_generic_payload& trans)
+    {
+        Route& route = routes.at(&trans);
+        tlm::tlm_phase phase = tlm::BEGIN_RESP;
+        sc_time delay = SC_ZERO_TIME;
+        // Restoring the address seen by the originating initiator
+        trans.set_address( route.address );
+        record_stats(target_nr, route.initiator_nr, trans, (sc_time_stamp() - route.start).value());
+        trace_transaction(target_nr, route.initiator_nr, route.address, trans);
+        response_in_progress[target_nr] = &trans;
+        tlm::tlm_sync_enum status = ( *target_socket[target_nr] )->nb_transport_bw( trans, phase, delay );
+        if (status == tlm::TLM_COMPLETED || (status == tlm::TLM_UPDATED && phase == tlm::END_RESP)) {
+            response_in_progress[target_nr] = nullptr;
+            response_free_at[target_nr] = sc_time_stamp() + delay;
+            response_done_event[target_nr].notify( delay );
+            complete_route( trans, delay );
+        }
+    }
+
+    // TLM-2 DMI method: the request is decoded like a b_transport and the
+    // granted range is translated back into the target socket address space
+    virtual bool get_direct_mem_ptr(int id, tlm::tlm_generic_payload& trans, tlm::tlm_dmi& dmi_data)
+    {
+        sc_dt::uint64 address = trans.get_address();
+        const AddressDecoder::Region* region = find_region( address, last_hit[id] );
+        if (!region)
+            return false;
+        sc_dt::uint64 masked_address = address & region->mask;
+
+        trans.set_address( masked_address );
+        bool granted = ( *initiator_socket[region->index] )->get_direct_mem_ptr( trans, dmi_data );
+
+        // Only the part of the region that the mask maps contiguously can be exposed
+        sc_dt::uint64 offset = address - masked_address;
+        uint64_t low, high;
+        region->linear_window(address, low, high);
+        sc_dt::uint64 start = std::max<sc_dt::uint64>(dmi_data.get_start_address(), low - offset);
+        sc_dt::uint64 end = std::min<sc_dt::uint64>(dmi_data.get_end_address(), high - offset);
+        if (dmi_data.get_dmi_ptr())
+            dmi_data.set_dmi_ptr( dmi_data.get_dmi_ptr() + (start - dmi_data.get_start_address()) );
+        dmi_data.set_start_address( start + offset );
+        dmi_data.set_end_address( end + offset );
+        return granted;
+    }
+
+    // TLM-2 DMI invalidation coming from initiator socket `id`: the range is
+    // translated into the router address space and broadcast to all target sockets
+    virtual void invalidate_direct_mem_ptr(int id, sc_dt::uint64 start_range, sc_dt::uint64 end_range)
+    {
+        const InitiatorConfig& config = initiatorsConfig[id];
+        if (config.topAddress <= config.baseAddress)
+            return;
+        sc_dt::uint64 start = config.baseAddress;
+        sc_dt::uint64 end = config.topAddress - 1;
+        sc_dt::uint64 bits = linear_bits(config.mask);
+        // When the whole window maps linearly onto the target we can be exact,
+        // otherwise we conservatively invalidate the whole window.
+        if ((start & ~bits) == (end & ~bits)) {
+            sc_dt::uint64 offset = start - (start & config.mask);
+            if (start_range > end - offset)
+                return;
+            start = std::max<sc_dt::uint64>(start, start_range + offset);
+            if (end_range < end - offset)
+                end = end_range + offset;
+        }
+        for (unsigned int i = 0; i < N_TARGETS; i++)
+            ( *target_socket[i] )->invalidate_direct_mem_ptr( start, end );
+    }
+
+    // TLM-2 debug transaction method: accesses spanning several regions are split
+    // and forwarded piecewise. The transfer stops at the first unmapped address or
+    // at the first target returning fewer bytes than requested.
+    virtual unsigned int transport_dbg(int id, tlm::tlm_generic_payload& trans)
+    {
+        sc_dt::uint64 address = trans.get_address();
+        unsigned char* ptr = trans.get_data_ptr();
+        unsigned int len = trans.get_data_length();
+
+        const AddressDecoder::Region* hint = nullptr;
+        unsigned int done = 0;
+        while (done < len) {
+            sc_dt::uint64 current = address + done;
+            const AddressDecoder::Region* region = find_region(current, hint);
+            if (!region)
+                break;
+            uint64_t low, high;
+            region->linear_window(current, low, high);
+            unsigned int chunk = std::min<uint64_t>(len - done, high - current + 1);
+
+            trans.set_address( current & region->mask );
+            trans.set_data_ptr( ptr + done );
+            trans.set_data_length( chunk );
+            unsigned int copied = ( *initiator_socket[region->index] )->transport_dbg( trans );
+            done += copied;
+            if (copied < chunk)
+                break;
+        }
+
+        trans.set_address( address );
+        trans.set_data_ptr( ptr );
+        trans.set_data_length( len );
+        return done;
+    }
+
+    inline unsigned int decode_address( sc_dt::uint64 address, sc_dt::uint64& masked_address )
+    {
+        const AddressDecoder::Region* hint = nullptr;
+        return decode_address(address, masked_address, hint);
+    }
+
+    inline unsigned int decode_address( sc_dt::uint64 address, sc_dt::uint64& masked_address,
+                                        const AddressDecoder::Region*& hint )
+    {
+        const AddressDecoder::Region* region = decode_region(address, hint);
+        if (!region)
+            return -1;
+        masked_address = address & region->mask;
+        return region->index;
+    }
+
+    // Region of `address`, nullptr when unmapped
+    inline const AddressDecoder::Region* find_region( sc_dt::uint64 address,
+            const AddressDecoder::Region*& hint )
+    {
+        if (!DECODER::is_static && decoder_dirty)
+            build_decoder();
+        return decoder.find(address, hint);
+    }
+
+    // As find_region, reporting an error when `address` is unmapped
+    inline const AddressDecoder::Region* decode_region( sc_dt::uint64 address,
+            const AddressDecoder::Region*& hint )
+    {
+        const AddressDecoder::Region* region = find_region(address, hint);
+        if (!region) {
             std::stringstream err;
             err << "TLM-ROUTER: Address " << hex << address << " does not match any defined subspaces";
             SC_REPORT_ERROR("TLM-ROUTER", err.str().c_str());
         }
-        return index;
+        return region;
     }
 
     explicit TLMRouter(sc_module_name name, const char* filename="/workdir/build/tlm_router.csv")
@@ -107,19 +573,56 @@ struct TLMRouter: sc_module
             sprintf(txt, "targ_socket_%u", i);
             target_socket[i] = new tlm_utils::simple_target_socket_tagged<TLMRouter>(txt);
             target_socket[i]->register_b_transport(this, &TLMRouter::b_transport,i);
+            target_socket[i]->register_get_direct_mem_ptr(this, &TLMRouter::get_direct_mem_ptr,i);
+            target_socket[i]->register_transport_dbg(this, &TLMRouter::transport_dbg,i);
+            target_socket[i]->register_nb_transport_fw(this, &TLMRouter::nb_transport_fw,i);
+            sprintf(txt, "resp_peq_%u", i);
+            response_peq[i] = new tlm_utils::peq_with_get<tlm::tlm_generic_payload>(txt);
+            response_in_progress[i] = nullptr;
         }
         for (unsigned int i = 0; i < N_INITIATORS; i++)
         {
             char txt[20];
             sprintf(txt, "init_socket_%u", i);
             initiator_socket[i] = new tlm_utils::simple_initiator_socket_tagged<TLMRouter>(txt);
-            initiatorsConfig[i] = {0, 0, 0};
+            initiator_socket[i]->register_invalidate_direct_mem_ptr(this, &TLMRouter::invalidate_direct_mem_ptr,i);
+            initiator_socket[i]->register_nb_transport_bw(this, &TLMRouter::nb_transport_bw,i);
+            sprintf(txt, "req_peq_%u", i);
+            request_peq[i] = new tlm_utils::peq_with_get<tlm::tlm_generic_payload>(txt);
+            request_in_progress[i] = nullptr;
+            next_grant[i] = 0;
+            if constexpr (DECODER::is_static)
+                initiatorsConfig[i] = DECODER::config(i);
+            else
+                initiatorsConfig[i] = {0, 0, 0};
         }
+        for (unsigned int i = 0; i < N_TARGETS; i++)
+            last_hit[i] = nullptr;
+
+        SC_METHOD(request_arbiter);
+        for (unsigned int i = 0; i < N_INITIATORS; i++)
+            sensitive << request_peq[i]->get_event() << request_done_event[i];
+        dont_initialize();
+        SC_METHOD(dump_stats);
+        sensitive << stats_event;
+        dont_initialize();
+        SC_METHOD(response_arbiter);
+        for (unsigned int i = 0; i < N_TARGETS; i++)
+            sensitive << response_peq[i]->get_event() << response_done_event[i];
+        dont_initialize();
     }
 
     SC_HAS_PROCESS(TLMRouter);
 };
 
+/**
+ * TLMRouter with the memory map fixed at compile time, e.g.
+ *   StaticTLMRouter<1, MappedRegion<0x0, 0x1000, 0xFFF>, MappedRegion<0x1000, 0x2000, 0xFFF>>
+ * Region i is served by initiator_socket[i]; setInitiatorProperties must not be used.
+ */
+template<unsigned int N_TARGETS, class... REGIONS>
+using StaticTLMRouter = TLMRouter<N_TARGETS, sizeof...(REGIONS), StaticAddressDecoder<REGIONS...>>;
+
 #endif //__TLMROUTER_H__
 
 
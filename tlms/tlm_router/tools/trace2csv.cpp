@@ -0,0 +1,67 @@
+/**
+ * @file trace2csv.cpp
+ * @author Riverlane, 2020
+ *
+ * Converts a binary trace written by TLMRouter::enable_binary_trace into the
+ * CSV layout of the router text trace.
+ * Usage: trace2csv <trace.bin> [trace.csv]
+ */
+
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "tlms/tlm_router/trace_format.hpp"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <trace.bin> [trace.csv]\n", argv[0]);
+        return 1;
+    }
+    int fd = open(argv[1], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TraceHeader)) {
+        fprintf(stderr, "Cannot read %s\n", argv[1]);
+        return 1;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Cannot map %s\n", argv[1]);
+        return 1;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    const TraceHeader* header = static_cast<const TraceHeader*>(map);
+    if (!check_trace_header(*header)) {
+        fprintf(stderr, "%s is not a router binary trace\n", argv[1]);
+        return 1;
+    }
+    const TraceRecord* records = reinterpret_cast<const TraceRecord*>(header + 1);
+    size_t nrecords = (st.st_size - sizeof(TraceHeader)) / sizeof(TraceRecord);
+
+    FILE* out = (argc > 2) ? fopen(argv[2], "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Cannot open %s\n", argv[2]);
+        return 1;
+    }
+    // Formatting into a large buffer and writing it out in one go
+    const size_t LINE_MAX_SIZE = 256;
+    std::vector<char> buf(1 << 20);
+    size_t pos = snprintf(buf.data(), buf.size(), "%s\n", TRACE_CSV_HEADER);
+    for (size_t i = 0; i < nrecords; i++) {
+        if (buf.size() - pos < LINE_MAX_SIZE) {
+            fwrite(buf.data(), 1, pos, out);
+            pos = 0;
+        }
+        pos += format_trace_csv(buf.data() + pos, LINE_MAX_SIZE, records[i]);
+        buf[pos++] = '\n';
+    }
+    fwrite(buf.data(), 1, pos, out);
+
+    if (out != stdout)
+        fclose(out);
+    munmap(map, st.st_size);
+    close(fd);
+    return 0;
+}
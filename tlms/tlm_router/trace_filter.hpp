@@ -0,0 +1,166 @@
+/**
+ * @file trace_filter.hpp
+ * @author Riverlane, 2020
+ *
+ */
+
+#ifndef __TRACE_FILTER_H__
+#define __TRACE_FILTER_H__
+
+#include "systemc"
+#include "tlm"
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+using namespace sc_core;
+
+/**
+ * TraceFilter selects which routed transactions end up in the router trace.
+ *
+ * Filters can be changed at any point of the simulation. With no filter set
+ * (the default) every transaction is traced; `accept` then costs a single
+ * branch. When several filters are set a transaction must pass all of them:
+ * - address windows: the (upstream) address is inside one of the windows;
+ * - target / initiator ids: the socket ids are enabled;
+ * - command: reads and writes can be turned off separately;
+ * - time window: start <= sc_time_stamp() < stop;
+ * - sampling: one transaction out of every N that passed the other filters.
+ */
+template<unsigned int N_TARGETS, unsigned int N_INITIATORS>
+class TraceFilter {
+public:
+    TraceFilter() {
+        reset();
+    }
+
+    /**
+     * Removes all filters: every transaction is traced again.
+     */
+    void reset() {
+        enabled = true;
+        windows.clear();
+        targets.set();
+        initiators.set();
+        reads = true;
+        writes = true;
+        start = SC_ZERO_TIME;
+        stop = sc_max_time();
+        sample_every = 1;
+        sample_count = 0;
+        update();
+    }
+
+    /**
+     * Turns the trace off (or back on) without touching the other filters.
+     */
+    void set_enabled(bool enable) {
+        enabled = enable;
+        update();
+    }
+
+    /**
+     * Only traces addresses in [low, high). Several windows can be added.
+     */
+    void add_address_window(uint64_t low, uint64_t high) {
+        windows.push_back({low, high});
+        update();
+    }
+
+    void clear_address_windows() {
+        windows.clear();
+        update();
+    }
+
+    void set_target(unsigned int id, bool enable) {
+        targets.set(id, enable);
+        update();
+    }
+
+    void set_initiator(unsigned int id, bool enable) {
+        initiators.set(id, enable);
+        update();
+    }
+
+    void set_commands(bool trace_reads, bool trace_writes) {
+        reads = trace_reads;
+        writes = trace_writes;
+        update();
+    }
+
+    /**
+     * Only traces transactions routed in [from, to).
+     */
+    void set_time_window(const sc_time& from, const sc_time& to = sc_max_time()) {
+        start = from;
+        stop = to;
+        update();
+    }
+
+    /**
+     * Traces one transaction out of every `n` (n <= 1 traces all of them).
+     */
+    void set_sampling(uint64_t n) {
+        sample_every = n ? n : 1;
+        sample_count = 0;
+        update();
+    }
+
+    inline bool accept(unsigned int target, unsigned int initiator, uint64_t address,
+                       tlm::tlm_command cmd) {
+        if (!active)
+            return true;
+        return check(target, initiator, address, cmd);
+    }
+
+private:
+    struct Window {
+        uint64_t low;
+        uint64_t high;
+    };
+
+    bool active {false};
+    bool enabled;
+    std::vector<Window> windows;
+    std::bitset<N_TARGETS> targets;
+    std::bitset<N_INITIATORS> initiators;
+    bool reads;
+    bool writes;
+    sc_time start;
+    sc_time stop;
+    uint64_t sample_every;
+    uint64_t sample_count;
+
+    void update() {
+        active = !enabled || !windows.empty() || !targets.all() || !initiators.all()
+                 || !reads || !writes || start != SC_ZERO_TIME || stop != sc_max_time()
+                 || sample_every > 1;
+    }
+
+    bool check(unsigned int target, unsigned int initiator, uint64_t address,
+               tlm::tlm_command cmd) {
+        if (!enabled || !targets.test(target) || !initiators.test(initiator))
+            return false;
+        if (cmd == tlm::TLM_WRITE_COMMAND ? !writes : !reads)
+            return false;
+        if (!windows.empty()) {
+            bool inside = false;
+            for (const Window& w : windows)
+                inside |= (address >= w.low) && (address < w.high);
+            if (!inside)
+                return false;
+        }
+        const sc_time& now = sc_time_stamp();
+        if (now < start || now >= stop)
+            return false;
+        if (sample_every > 1) {
+            bool take = (sample_count == 0);
+            if (++sample_count == sample_every)
+                sample_count = 0;
+            return take;
+        }
+        return true;
+    }
+};
+
+#endif //__TRACE_FILTER_H__
@@ -0,0 +1,95 @@
+/**
+ * @file trace_format.hpp
+ * @author Riverlane, 2020
+ *
+ * Layout of the binary transaction traces written by TLMRouter and helpers
+ * to turn them back into the CSV format of the text traces.
+ * This header does not depend on SystemC so that offline tools can use it.
+ */
+
+#ifndef __TRACE_FORMAT_H__
+#define __TRACE_FORMAT_H__
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+static constexpr char TRACE_MAGIC[8] = {'D', 'M', 'T', 'R', 'A', 'C', 'E', '\0'};
+static constexpr uint32_t TRACE_VERSION = 1;
+
+/**
+ * File header, followed by a sequence of TraceRecord
+ */
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint8_t reserved[48];
+};
+static_assert(sizeof(TraceHeader) == 64, "TraceHeader must be 64 bytes");
+
+/**
+ * One routed transaction. Fixed size, host endianness.
+ */
+struct TraceRecord {
+    uint64_t time_ps;       // simulation time in picoseconds
+    uint64_t address;       // address as seen by the target socket
+    uint32_t target;        // target socket id (upstream)
+    uint32_t initiator;     // initiator socket id (downstream)
+    uint32_t len;
+    uint32_t wid;
+    uint32_t byte_enables;  // first four byte enables, 0 when unused
+    uint32_t data;          // first four data bytes
+    uint8_t  cmd;           // tlm::tlm_command
+    uint8_t  reserved[7];
+};
+static_assert(sizeof(TraceRecord) == 48, "TraceRecord must be 48 bytes");
+
+inline void init_trace_header(TraceHeader& header) {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+}
+
+inline bool check_trace_header(const TraceHeader& header) {
+    return (memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0) &&
+           (header.version == TRACE_VERSION) && (header.record_size == sizeof(TraceRecord));
+}
+
+/**
+ * Formats a time in picoseconds the way sc_time::to_string does:
+ * trailing zeros are folded into the largest unit that keeps the value integral.
+ */
+inline int format_trace_time(char* buf, size_t size, uint64_t time_ps) {
+    static const char* units[] = {"fs", "ps", "ns", "us", "ms", "s"};
+    if (time_ps == 0)
+        return snprintf(buf, size, "0 s");
+    int n = 3; // one picosecond is 10^3 femtoseconds
+    while ((time_ps % 10) == 0) {
+        time_ps /= 10;
+        n++;
+    }
+    if (n >= 15)
+        return snprintf(buf, size, "%" PRIu64 "%.*s s", time_ps, n - 15, "000000000000000000000");
+    return snprintf(buf, size, "%" PRIu64 "%.*s %s", time_ps, n % 3, "00", units[n / 3]);
+}
+
+/**
+ * Formats a record as a line of the router CSV trace (without newline)
+ */
+inline int format_trace_csv(char* buf, size_t size, const TraceRecord& record) {
+    int n = format_trace_time(buf, size, record.time_ps);
+    n += snprintf(buf + n, size - n, ",%u,%u,0x%" PRIx64 ",%s,%u,%u,0x%x,0x%x",
+                  record.target, record.initiator, record.address,
+                  record.cmd == 1 ? "write" : "read",
+                  record.len, record.wid, record.byte_enables, record.data);
+    return n;
+}
+
+static constexpr const char* TRACE_CSV_HEADER =
+    "TimeStamp, Target, Initiator, Address, Cmd, Value, Len, Wid, Byt, Data";
+
+#endif //__TRACE_FORMAT_H__